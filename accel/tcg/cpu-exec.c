@@ -148,6 +148,9 @@ static void init_delay_params(SyncClocks *sc, const CPUState *cpu)
 }
 #endif /* CONFIG USER ONLY */
 
+#define tb_stats_inc(cpu, field) \
+    qatomic_set(&(cpu)->tb_stats.field, (cpu)->tb_stats.field + 1)
+
 uint32_t curr_cflags(CPUState *cpu)
 {
     uint32_t cflags = cpu->tcg_cflags;
@@ -170,6 +173,35 @@ uint32_t curr_cflags(CPUState *cpu)
     return cflags;
 }
 
+static inline bool tb_lookup_cmp(const TranslationBlock *tb, CPUState *cpu,
+                                 target_ulong pc, target_ulong cs_base,
+                                 uint32_t flags, uint32_t cflags)
+{
+    return (tb &&
+            tb->pc == pc &&
+            tb->cs_base == cs_base &&
+            tb->flags == flags &&
+            tb->trace_vcpu_dstate == *cpu->trace_dstate &&
+            tb_cflags(tb) == cflags);
+}
+
+/*
+ * Insert @tb as the most recently used way of its jump cache set,
+ * demoting the previous occupant to the other way.  A stale entry that
+ * races with do_tb_phys_invalidate() is harmless: invalid TBs have
+ * CF_INVALID set and therefore never match in tb_lookup().
+ */
+static inline void tb_jmp_cache_insert(CPUState *cpu, uint32_t hash,
+                                       TranslationBlock *tb)
+{
+    TranslationBlock *old = qatomic_read(&cpu->tb_jmp_cache[hash]);
+
+    if (old && old != tb) {
+        qatomic_set(&cpu->tb_jmp_cache[tb_jmp_cache_way(hash)], old);
+    }
+    qatomic_set(&cpu->tb_jmp_cache[hash], tb);
+}
+
 /* Might cause an exception, so have a longjmp destination ready */
 static inline TranslationBlock *tb_lookup(CPUState *cpu, target_ulong pc,
                                           target_ulong cs_base,
@@ -183,20 +215,30 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, target_ulong pc,
 
     hash = tb_jmp_cache_hash_func(pc);
     tb = qatomic_rcu_read(&cpu->tb_jmp_cache[hash]);
+    if (likely(tb_lookup_cmp(tb, cpu, pc, cs_base, flags, cflags))) {
+        tb_stats_inc(cpu, jmp_cache_hit);
+        return tb;
+    }
 
-    if (likely(tb &&
-               tb->pc == pc &&
-               tb->cs_base == cs_base &&
-               tb->flags == flags &&
-               tb->trace_vcpu_dstate == *cpu->trace_dstate &&
-               tb_cflags(tb) == cflags)) {
+    /*
+     * Indirect branches that alternate between two targets which alias
+     * in the jump cache (polymorphic dispatch, interpreter loops) would
+     * otherwise fall through to the QHT on every other lookup.
+     */
+    tb = qatomic_rcu_read(&cpu->tb_jmp_cache[tb_jmp_cache_way(hash)]);
+    if (tb_lookup_cmp(tb, cpu, pc, cs_base, flags, cflags)) {
+        tb_stats_inc(cpu, jmp_cache_hit);
+        tb_jmp_cache_insert(cpu, hash, tb);
         return tb;
     }
+
     tb = tb_htable_lookup(cpu, pc, cs_base, flags, cflags);
     if (tb == NULL) {
+        tb_stats_inc(cpu, lookup_miss);
         return NULL;
     }
-    qatomic_set(&cpu->tb_jmp_cache[hash], tb);
+    tb_stats_inc(cpu, htable_hit);
+    tb_jmp_cache_insert(cpu, hash, tb);
     return tb;
 }
 
@@ -326,6 +368,8 @@ const void *HELPER(lookup_tb_ptr)(CPUArchState *env)
 
     tb = tb_lookup(cpu, pc, cs_base, flags, cflags);
     if (tb == NULL) {
+        tb_stats_inc(cpu, goto_ptr_miss);
+        cpu->tb_stats.goto_ptr_missed = true;
         return tcg_code_gen_epilogue;
     }
 
@@ -847,10 +891,23 @@ static inline void cpu_loop_exec_tb(CPUState *cpu, TranslationBlock *tb,
     trace_exec_tb(tb, tb->pc);
     tb = cpu_tb_exec(cpu, tb, tb_exit);
     if (*tb_exit != TB_EXIT_REQUESTED) {
+        /*
+         * A TB pointer with an exit index means a goto_tb that has not
+         * been chained yet; exit_tb 0 comes back without a TB, and so
+         * does a goto_ptr miss, which is already counted as such.
+         */
+        if (tb) {
+            tb_stats_inc(cpu, exit_goto_tb);
+        } else if (cpu->tb_stats.goto_ptr_missed) {
+            cpu->tb_stats.goto_ptr_missed = false;
+        } else {
+            tb_stats_inc(cpu, exit_tb);
+        }
         *last_tb = tb;
         return;
     }
 
+    tb_stats_inc(cpu, exit_requested);
     *last_tb = NULL;
     insns_left = qatomic_read(&cpu_neg(cpu)->icount_decr.u32);
     if (insns_left < 0) {
@@ -985,7 +1042,7 @@ int cpu_exec(CPUState *cpu)
                  * We add the TB in the virtual pc hash table
                  * for the fast lookup
                  */
-                qatomic_set(&cpu->tb_jmp_cache[tb_jmp_cache_hash_func(pc)], tb);
+                tb_jmp_cache_insert(cpu, tb_jmp_cache_hash_func(pc), tb);
             }
 
 #ifndef CONFIG_USER_ONLY
@@ -1067,6 +1124,33 @@ static void dump_drift_info(GString *buf)
     }
 }
 
+static void dump_exec_stats(GString *buf)
+{
+    size_t jmp_cache_hit = 0, htable_hit = 0, lookup_miss = 0;
+    size_t goto_ptr_miss = 0, exit_goto_tb = 0, exit_tb = 0;
+    size_t exit_requested = 0;
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        jmp_cache_hit += qatomic_read(&cpu->tb_stats.jmp_cache_hit);
+        htable_hit += qatomic_read(&cpu->tb_stats.htable_hit);
+        lookup_miss += qatomic_read(&cpu->tb_stats.lookup_miss);
+        goto_ptr_miss += qatomic_read(&cpu->tb_stats.goto_ptr_miss);
+        exit_goto_tb += qatomic_read(&cpu->tb_stats.exit_goto_tb);
+        exit_tb += qatomic_read(&cpu->tb_stats.exit_tb);
+        exit_requested += qatomic_read(&cpu->tb_stats.exit_requested);
+    }
+
+    g_string_append_printf(buf, "\nExecution loop:\n");
+    g_string_append_printf(buf, "TB jmp cache hits   %zu\n", jmp_cache_hit);
+    g_string_append_printf(buf, "TB htable hits      %zu\n", htable_hit);
+    g_string_append_printf(buf, "TB lookup misses    %zu\n", lookup_miss);
+    g_string_append_printf(buf, "goto_ptr misses     %zu\n", goto_ptr_miss);
+    g_string_append_printf(buf, "unchained exits     %zu\n", exit_goto_tb);
+    g_string_append_printf(buf, "exit_tb exits       %zu\n", exit_tb);
+    g_string_append_printf(buf, "requested exits     %zu\n", exit_requested);
+}
+
 HumanReadableText *qmp_x_query_jit(Error **errp)
 {
     g_autoptr(GString) buf = g_string_new("");
@@ -1077,6 +1161,7 @@ HumanReadableText *qmp_x_query_jit(Error **errp)
     }
 
     dump_exec_info(buf);
+    dump_exec_stats(buf);
     dump_drift_info(buf);
 
     return human_readable_text_from_str(buf);
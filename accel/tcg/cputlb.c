@@ -120,7 +120,7 @@ static void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
  * @desc: The CPUTLBDesc portion of the TLB
  * @fast: The CPUTLBDescFast portion of the same TLB
  *
- * Called with tlb_lock_held.
+ * Called with tlb_lock_held.  Returns true if the TLB was resized.
  *
  * We have two main constraints when resizing a TLB: (1) we only resize it
  * on a TLB flush (otherwise we'd have to take a perf hit by either rehashing
@@ -155,7 +155,7 @@ static void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
  * high), since otherwise we are likely to have a significant amount of
  * conflict misses.
  */
-static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
+static bool tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
                                   int64_t now)
 {
     size_t old_size = tlb_n_entries(fast);
@@ -196,7 +196,7 @@ static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
         if (window_expired) {
             tlb_window_reset(desc, now, desc->n_used_entries);
         }
-        return;
+        return false;
     }
 
     g_free(fast->table);
@@ -228,6 +228,7 @@ static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
         fast->table = g_try_new(CPUTLBEntry, new_size);
         desc->iotlb = g_try_new(CPUIOTLBEntry, new_size);
     }
+    return true;
 }
 
 static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
@@ -246,7 +247,10 @@ static void tlb_flush_one_mmuidx_locked(CPUArchState *env, int mmu_idx,
     CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
     CPUTLBDescFast *fast = &env_tlb(env)->f[mmu_idx];
 
-    tlb_mmu_resize_locked(desc, fast, now);
+    if (tlb_mmu_resize_locked(desc, fast, now)) {
+        qatomic_set(&env_tlb(env)->c.resize_count,
+                    env_tlb(env)->c.resize_count + 1);
+    }
     tlb_mmu_flush_locked(desc, fast);
 }
 
@@ -339,6 +343,23 @@ void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
     *pelide = elide;
 }
 
+void tlb_fill_counts(size_t *pfill, size_t *pvictim_hit, size_t *presize)
+{
+    CPUState *cpu;
+    size_t fill = 0, victim_hit = 0, resize = 0;
+
+    CPU_FOREACH(cpu) {
+        CPUArchState *env = cpu->env_ptr;
+
+        fill += qatomic_read(&env_tlb(env)->c.fill_count);
+        victim_hit += qatomic_read(&env_tlb(env)->c.victim_hit_count);
+        resize += qatomic_read(&env_tlb(env)->c.resize_count);
+    }
+    *pfill = fill;
+    *pvictim_hit = victim_hit;
+    *presize = resize;
+}
+
 static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
 {
     CPUArchState *env = cpu->env_ptr;
@@ -493,18 +514,53 @@ static inline void tlb_flush_vtlb_page_locked(CPUArchState *env, int mmu_idx,
     tlb_flush_vtlb_page_mask_locked(env, mmu_idx, page, -1);
 }
 
-static void tlb_flush_page_locked(CPUArchState *env, int midx,
-                                  target_ulong page)
+/*
+ * Flush every entry within the large page region of @midx.  When the
+ * region covers no more pages than there are tlb entries, walking it is
+ * cheaper than flushing (and then refilling) the entire tlb, and the
+ * entries for the rest of the address space survive.
+ * Return true if the entire tlb was flushed instead.
+ *
+ * Called with tlb_c.lock held.
+ */
+static bool tlb_flush_large_page_locked(CPUArchState *env, int midx)
 {
     target_ulong lp_addr = env_tlb(env)->d[midx].large_page_addr;
     target_ulong lp_mask = env_tlb(env)->d[midx].large_page_mask;
+    target_ulong lp_pages = -lp_mask >> TARGET_PAGE_BITS;
+    target_ulong i;
 
-    /* Check if we need to flush due to large pages.  */
-    if ((page & lp_mask) == lp_addr) {
+    if (lp_pages == 0 || lp_pages > tlb_n_entries(&env_tlb(env)->f[midx])) {
         tlb_debug("forcing full flush midx %d ("
                   TARGET_FMT_lx "/" TARGET_FMT_lx ")\n",
                   midx, lp_addr, lp_mask);
         tlb_flush_one_mmuidx_locked(env, midx, get_clock_realtime());
+        return true;
+    }
+
+    tlb_debug("flushing large page region midx %d ("
+              TARGET_FMT_lx "/" TARGET_FMT_lx ")\n",
+              midx, lp_addr, lp_mask);
+    for (i = 0; i < lp_pages; i++) {
+        target_ulong page = lp_addr + (i << TARGET_PAGE_BITS);
+
+        if (tlb_flush_entry_locked(tlb_entry(env, midx, page), page)) {
+            tlb_n_used_entries_dec(env, midx);
+        }
+    }
+    tlb_flush_vtlb_page_mask_locked(env, midx, lp_addr, lp_mask);
+    return false;
+}
+
+static void tlb_flush_page_locked(CPUArchState *env, int midx,
+                                  target_ulong page)
+{
+    target_ulong lp_addr = env_tlb(env)->d[midx].large_page_addr;
+    target_ulong lp_mask = env_tlb(env)->d[midx].large_page_mask;
+
+    /* Check if we need to flush due to large pages.  */
+    if ((page & lp_mask) == lp_addr) {
+        tlb_flush_large_page_locked(env, midx);
     } else {
         if (tlb_flush_entry_locked(tlb_entry(env, midx, page), page)) {
             tlb_n_used_entries_dec(env, midx);
@@ -738,11 +794,8 @@ static void tlb_flush_range_locked(CPUArchState *env, int midx,
      * Because large_page_mask contains all 1's from the msb,
      * we only need to test the end of the range.
      */
-    if (((addr + len - 1) & d->large_page_mask) == d->large_page_addr) {
-        tlb_debug("forcing full flush midx %d ("
-                  TARGET_FMT_lx "/" TARGET_FMT_lx ")\n",
-                  midx, d->large_page_addr, d->large_page_mask);
-        tlb_flush_one_mmuidx_locked(env, midx, get_clock_realtime());
+    if (((addr + len - 1) & d->large_page_mask) == d->large_page_addr &&
+        tlb_flush_large_page_locked(env, midx)) {
         return;
     }
 
@@ -1071,8 +1124,10 @@ void tlb_set_dirty(CPUState *cpu, target_ulong vaddr)
     qemu_spin_unlock(&env_tlb(env)->c.lock);
 }
 
-/* Our TLB does not support large pages, so remember the area covered by
-   large pages and trigger a full TLB flush if these are invalidated.  */
+/*
+ * Our TLB does not support large pages, so remember the area covered by
+ * large pages and flush all of it if any of these are invalidated.
+ */
 static void tlb_add_large_page(CPUArchState *env, int mmu_idx,
                                target_ulong vaddr, target_ulong size)
 {
@@ -1304,8 +1359,12 @@ static void tlb_fill(CPUState *cpu, target_ulong addr, int size,
                      MMUAccessType access_type, int mmu_idx, uintptr_t retaddr)
 {
     CPUClass *cc = CPU_GET_CLASS(cpu);
+    CPUArchState *env = cpu->env_ptr;
     bool ok;
 
+    qatomic_set(&env_tlb(env)->c.fill_count,
+                env_tlb(env)->c.fill_count + 1);
+
     /*
      * This is not a probe, so only valid return is success; failure
      * should result in exception + longjmp to the cpu loop.
@@ -1483,6 +1542,9 @@ static bool victim_tlb_hit(CPUArchState *env, size_t mmu_idx, size_t index,
             CPUIOTLBEntry tmpio, *io = &env_tlb(env)->d[mmu_idx].iotlb[index];
             CPUIOTLBEntry *vio = &env_tlb(env)->d[mmu_idx].viotlb[vidx];
             tmpio = *io; *io = *vio; *vio = tmpio;
+
+            qatomic_set(&env_tlb(env)->c.victim_hit_count,
+                        env_tlb(env)->c.victim_hit_count + 1);
             return true;
         }
     }
@@ -1557,10 +1619,7 @@ static void notdirty_write(CPUState *cpu, vaddr mem_vaddr, unsigned size,
     trace_memory_notdirty_write_access(mem_vaddr, ram_addr, size);
 
     if (!cpu_physical_memory_get_dirty_flag(ram_addr, DIRTY_MEMORY_CODE)) {
-        struct page_collection *pages
-            = page_collection_lock(ram_addr, ram_addr + size);
-        tb_invalidate_phys_page_fast(pages, ram_addr, size, retaddr);
-        page_collection_unlock(pages);
+        tb_invalidate_phys_page_fast(ram_addr, size, retaddr);
     }
 
     /*
@@ -1608,6 +1667,8 @@ static int probe_access_internal(CPUArchState *env, target_ulong addr,
             CPUState *cs = env_cpu(env);
             CPUClass *cc = CPU_GET_CLASS(cs);
 
+            qatomic_set(&env_tlb(env)->c.fill_count,
+                        env_tlb(env)->c.fill_count + 1);
             if (!cc->tcg_ops->tlb_fill(cs, addr, fault_size, access_type,
                                        mmu_idx, nonfault, retaddr)) {
                 /* Non-faulting page table read failed.  */
@@ -59,6 +59,18 @@ static inline unsigned int tb_jmp_cache_hash_func(target_ulong pc)
 
 #endif /* CONFIG_SOFTMMU */
 
+/*
+ * The jump cache is 2-way set associative: the entry for a pc lives
+ * either in slot tb_jmp_cache_hash_func(pc) or in its neighbour, which
+ * differs only in the lowest bit.  Both ways of a set thus belong to
+ * the same TB_JMP_PAGE_SIZE block, so flushing the jump cache for a
+ * page still clears every entry that may point into it.
+ */
+static inline unsigned int tb_jmp_cache_way(unsigned int hash)
+{
+    return hash ^ 1;
+}
+
 static inline
 uint32_t tb_hash_func(tb_page_addr_t phys_pc, target_ulong pc, uint32_t flags,
                       uint32_t cf_mask, uint32_t trace_vcpu_dstate)
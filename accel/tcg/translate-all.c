@@ -24,6 +24,7 @@
 #include "disas/disas.h"
 #include "exec/exec-all.h"
 #include "tcg/tcg.h"
+#include "tcg/perf.h"
 #if defined(CONFIG_USER_ONLY)
 #include "qemu.h"
 #if defined(__FreeBSD__) || defined(__FreeBSD_kernel__)
@@ -1210,6 +1211,9 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
         if (qatomic_read(&cpu->tb_jmp_cache[h]) == tb) {
             qatomic_set(&cpu->tb_jmp_cache[h], NULL);
         }
+        if (qatomic_read(&cpu->tb_jmp_cache[tb_jmp_cache_way(h)]) == tb) {
+            qatomic_set(&cpu->tb_jmp_cache[tb_jmp_cache_way(h)], NULL);
+        }
     }
 
     /* suppress this TB from the two jump lists */
@@ -1627,6 +1631,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
      */
     if (phys_pc == -1) {
         tb->page_addr[0] = tb->page_addr[1] = -1;
+        perf_report_code(tb, tb->tc.ptr);
         return tb;
     }
 
@@ -1657,6 +1662,12 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         tcg_tb_remove(tb);
         return existing_tb;
     }
+
+    /*
+     * Only report code that stays in the buffer: a TB that lost the race
+     * above is overwritten by the next translation.
+     */
+    perf_report_code(tb, tb->tc.ptr);
     return tb;
 }
 
@@ -1815,13 +1826,11 @@ void tb_invalidate_phys_range(target_ulong start, target_ulong end)
 /* len must be <= 8 and start must be a multiple of len.
  * Called via softmmu_template.h when code areas are written to with
  * iothread mutex not held.
- *
- * Call with all @pages in the range [@start, @start + len[ locked.
  */
-void tb_invalidate_phys_page_fast(struct page_collection *pages,
-                                  tb_page_addr_t start, int len,
+void tb_invalidate_phys_page_fast(tb_page_addr_t start, int len,
                                   uintptr_t retaddr)
 {
+    struct page_collection *pages;
     PageDesc *p;
 
     assert_memory_lock();
@@ -1831,7 +1840,13 @@ void tb_invalidate_phys_page_fast(struct page_collection *pages,
         return;
     }
 
-    assert_page_locked(p);
+    /*
+     * Most writes to a page containing code, e.g. from a guest JIT
+     * emitting new code next to existing TBs, do not hit any TB.
+     * Check the code bitmap with just this page locked, so that such
+     * writes do not have to lock the pages of all the TBs on the page.
+     */
+    page_lock(p);
     if (!p->code_bitmap &&
         ++p->code_write_count >= SMC_BITMAP_USE_THRESHOLD) {
         build_page_bitmap(p);
@@ -1842,14 +1857,17 @@ void tb_invalidate_phys_page_fast(struct page_collection *pages,
 
         nr = start & ~TARGET_PAGE_MASK;
         b = p->code_bitmap[BIT_WORD(nr)] >> (nr & (BITS_PER_LONG - 1));
-        if (b & ((1 << len) - 1)) {
-            goto do_invalidate;
+        if (!(b & ((1 << len) - 1))) {
+            page_unlock(p);
+            return;
         }
-    } else {
-    do_invalidate:
-        tb_invalidate_phys_page_range__locked(pages, p, start, start + len,
-                                              retaddr);
     }
+    page_unlock(p);
+
+    pages = page_collection_lock(start, start + len);
+    tb_invalidate_phys_page_range__locked(pages, p, start, start + len,
+                                          retaddr);
+    page_collection_unlock(pages);
 }
 #else
 /* Called with mmap_lock held. If pc is not 0 then it indicates the
@@ -2076,6 +2094,7 @@ void dump_exec_info(GString *buf)
     struct tb_tree_stats tst = {};
     struct qht_stats hst;
     size_t nb_tbs, flush_full, flush_part, flush_elide;
+    size_t fill, victim_hit, resize;
 
     tcg_tb_foreach(tb_tree_stats_iter, &tst);
     nb_tbs = tst.nb_tbs;
@@ -2121,6 +2140,11 @@ void dump_exec_info(GString *buf)
     g_string_append_printf(buf, "TLB full flushes    %zu\n", flush_full);
     g_string_append_printf(buf, "TLB partial flushes %zu\n", flush_part);
     g_string_append_printf(buf, "TLB elided flushes  %zu\n", flush_elide);
+
+    tlb_fill_counts(&fill, &victim_hit, &resize);
+    g_string_append_printf(buf, "TLB fills           %zu\n", fill);
+    g_string_append_printf(buf, "TLB victim hits     %zu\n", victim_hit);
+    g_string_append_printf(buf, "TLB resizes         %zu\n", resize);
     tcg_dump_info(buf);
 }
 
@@ -33,6 +33,11 @@
 #include <zstd_errors.h>
 #endif
 
+#ifdef CONFIG_LZ4
+#include <lz4.h>
+#endif
+
+#include "qemu/bswap.h"
 #include "qcow2.h"
 #include "block/thread-pool.h"
 #include "crypto.h"
@@ -325,6 +330,80 @@ static ssize_t qcow2_zstd_decompress(void *dest, size_t dest_size,
 }
 #endif
 
+#ifdef CONFIG_LZ4
+
+/*
+ * An lz4 block does not record its own length and qcow2 only knows the
+ * compressed size with sector precision, so the block is preceded by its
+ * length as a big-endian 32-bit value.
+ */
+#define QCOW2_LZ4_HEADER_SIZE sizeof(uint32_t)
+
+/*
+ * qcow2_lz4_compress()
+ *
+ * Compress @src_size bytes of data using lz4 compression method
+ *
+ * @dest - destination buffer, @dest_size bytes
+ * @src - source buffer, @src_size bytes
+ *
+ * Returns: compressed size on success
+ *          -ENOMEM destination buffer is not enough to store compressed data
+ */
+static ssize_t qcow2_lz4_compress(void *dest, size_t dest_size,
+                                  const void *src, size_t src_size)
+{
+    int len;
+
+    if (dest_size <= QCOW2_LZ4_HEADER_SIZE) {
+        return -ENOMEM;
+    }
+
+    len = LZ4_compress_default(src, (char *)dest + QCOW2_LZ4_HEADER_SIZE,
+                               src_size, dest_size - QCOW2_LZ4_HEADER_SIZE);
+    if (len <= 0) {
+        return -ENOMEM;
+    }
+
+    stl_be_p(dest, len);
+    return QCOW2_LZ4_HEADER_SIZE + len;
+}
+
+/*
+ * qcow2_lz4_decompress()
+ *
+ * Decompress some data (not more than @src_size bytes) to produce exactly
+ * @dest_size bytes using lz4 compression method
+ *
+ * @dest - destination buffer, @dest_size bytes
+ * @src - source buffer, @src_size bytes
+ *
+ * Returns: 0 on success
+ *          -EIO on any error
+ */
+static ssize_t qcow2_lz4_decompress(void *dest, size_t dest_size,
+                                    const void *src, size_t src_size)
+{
+    uint32_t len;
+
+    if (src_size < QCOW2_LZ4_HEADER_SIZE) {
+        return -EIO;
+    }
+
+    len = ldl_be_p(src);
+    if (len > src_size - QCOW2_LZ4_HEADER_SIZE) {
+        return -EIO;
+    }
+
+    if (LZ4_decompress_safe((const char *)src + QCOW2_LZ4_HEADER_SIZE, dest,
+                            len, dest_size) != dest_size) {
+        return -EIO;
+    }
+
+    return 0;
+}
+#endif
+
 static int qcow2_compress_pool_func(void *opaque)
 {
     Qcow2CompressData *data = opaque;
@@ -380,6 +459,11 @@ qcow2_co_compress(BlockDriverState *bs, void *dest, size_t dest_size,
     case QCOW2_COMPRESSION_TYPE_ZSTD:
         fn = qcow2_zstd_compress;
         break;
+#endif
+#ifdef CONFIG_LZ4
+    case QCOW2_COMPRESSION_TYPE_LZ4:
+        fn = qcow2_lz4_compress;
+        break;
 #endif
     default:
         abort();
@@ -417,6 +501,11 @@ qcow2_co_decompress(BlockDriverState *bs, void *dest, size_t dest_size,
     case QCOW2_COMPRESSION_TYPE_ZSTD:
         fn = qcow2_zstd_decompress;
         break;
+#endif
+#ifdef CONFIG_LZ4
+    case QCOW2_COMPRESSION_TYPE_LZ4:
+        fn = qcow2_lz4_decompress;
+        break;
 #endif
     default:
         abort();
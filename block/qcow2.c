@@ -1255,12 +1255,57 @@ static int qcow2_update_options(BlockDriverState *bs, QDict *options,
     return ret;
 }
 
+/*
+ * Values of the compression_type header field.  Qcow2CompressionType
+ * leaves out the types that are not compiled in, so its values cannot be
+ * stored in the image as they are.
+ */
+static const uint8_t qcow2_compression_type_header[] = {
+    [QCOW2_COMPRESSION_TYPE_ZLIB] = 0,
+#ifdef CONFIG_ZSTD
+    [QCOW2_COMPRESSION_TYPE_ZSTD] = 1,
+#endif
+#ifdef CONFIG_LZ4
+    [QCOW2_COMPRESSION_TYPE_LZ4] = 2,
+#endif
+};
+
+/* Every compression type defined by the specification, by header value */
+static const char *const qcow2_compression_type_names[] = {
+    "zlib", "zstd", "lz4",
+};
+
+static int qcow2_compression_type_from_header(uint8_t value,
+                                              Qcow2CompressionType *type,
+                                              Error **errp)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(qcow2_compression_type_header); i++) {
+        if (qcow2_compression_type_header[i] == value) {
+            *type = i;
+            return 0;
+        }
+    }
+
+    if (value < ARRAY_SIZE(qcow2_compression_type_names)) {
+        error_setg(errp, "qcow2: compression type '%s' is not supported "
+                   "in this build", qcow2_compression_type_names[value]);
+    } else {
+        error_setg(errp, "qcow2: unknown compression type: %u", value);
+    }
+    return -ENOTSUP;
+}
+
 static int validate_compression_type(BDRVQcow2State *s, Error **errp)
 {
     switch (s->compression_type) {
     case QCOW2_COMPRESSION_TYPE_ZLIB:
 #ifdef CONFIG_ZSTD
     case QCOW2_COMPRESSION_TYPE_ZSTD:
+#endif
+#ifdef CONFIG_LZ4
+    case QCOW2_COMPRESSION_TYPE_LZ4:
 #endif
         break;
 
@@ -1415,7 +1460,11 @@ static int coroutine_fn qcow2_do_open(BlockDriverState *bs, QDict *options,
      * the only valid (default) compression type in that case
      */
     if (header.header_length > offsetof(QCowHeader, compression_type)) {
-        s->compression_type = header.compression_type;
+        ret = qcow2_compression_type_from_header(header.compression_type,
+                                                 &s->compression_type, errp);
+        if (ret) {
+            goto fail;
+        }
     } else {
         s->compression_type = QCOW2_COMPRESSION_TYPE_ZLIB;
     }
@@ -2887,7 +2936,8 @@ int qcow2_update_header(BlockDriverState *bs)
         .autoclear_features     = cpu_to_be64(s->autoclear_features),
         .refcount_order         = cpu_to_be32(s->refcount_order),
         .header_length          = cpu_to_be32(header_length),
-        .compression_type       = s->compression_type,
+        .compression_type       =
+            qcow2_compression_type_header[s->compression_type],
     };
 
     /* For older versions, write a shorter header */
@@ -3435,7 +3485,7 @@ qcow2_co_create(BlockdevCreateOptions *create_options, Error **errp)
     int refcount_order;
     uint64_t *refcount_table;
     int ret;
-    uint8_t compression_type = QCOW2_COMPRESSION_TYPE_ZLIB;
+    Qcow2CompressionType compression_type = QCOW2_COMPRESSION_TYPE_ZLIB;
 
     assert(create_options->driver == BLOCKDEV_DRIVER_QCOW2);
     qcow2_opts = &create_options->u.qcow2;
@@ -3604,8 +3654,11 @@ qcow2_co_create(BlockdevCreateOptions *create_options, Error **errp)
         switch (qcow2_opts->compression_type) {
 #ifdef CONFIG_ZSTD
         case QCOW2_COMPRESSION_TYPE_ZSTD:
-            break;
 #endif
+#ifdef CONFIG_LZ4
+        case QCOW2_COMPRESSION_TYPE_LZ4:
+#endif
+            break;
         default:
             error_setg(errp, "Unknown compression type");
             goto out;
@@ -3637,7 +3690,8 @@ qcow2_co_create(BlockdevCreateOptions *create_options, Error **errp)
         .refcount_table_clusters    = cpu_to_be32(1),
         .refcount_order             = cpu_to_be32(refcount_order),
         /* don't deal with endianness since compression_type is 1 byte long */
-        .compression_type           = compression_type,
+        .compression_type           =
+            qcow2_compression_type_header[compression_type],
         .header_length              = cpu_to_be32(sizeof(*header)),
     };
 
@@ -5138,6 +5192,22 @@ static int qcow2_get_info(BlockDriverState *bs, BlockDriverInfo *bdi)
     return 0;
 }
 
+static BlockStatsSpecific *qcow2_get_specific_stats(BlockDriverState *bs)
+{
+    BDRVQcow2State *s = bs->opaque;
+    BlockStatsSpecific *stats = g_new0(BlockStatsSpecific, 1);
+
+    stats->driver = BLOCKDEV_DRIVER_QCOW2;
+    qcow2_cache_get_stats(s->l2_table_cache,
+                          &stats->u.qcow2.l2_cache_hits,
+                          &stats->u.qcow2.l2_cache_misses);
+    qcow2_cache_get_stats(s->refcount_block_cache,
+                          &stats->u.qcow2.refcount_cache_hits,
+                          &stats->u.qcow2.refcount_cache_misses);
+
+    return stats;
+}
+
 static ImageInfoSpecific *qcow2_get_specific_info(BlockDriverState *bs,
                                                   Error **errp)
 {
@@ -5415,8 +5485,8 @@ static int qcow2_downgrade(BlockDriverState *bs, int target_version,
             return -EINVAL;
         }
         if (ret) {
-            error_setg(errp, "Cannot downgrade an image with zstd compression "
-                       "type and existing compressed clusters");
+            error_setg(errp, "Cannot downgrade an image with a non-zlib "
+                       "compression type and existing compressed clusters");
             return -ENOTSUP;
         }
         /*
@@ -6067,6 +6137,7 @@ BlockDriver bdrv_qcow2 = {
     .bdrv_measure           = qcow2_measure,
     .bdrv_get_info          = qcow2_get_info,
     .bdrv_get_specific_info = qcow2_get_specific_info,
+    .bdrv_get_specific_stats = qcow2_get_specific_stats,
 
     .bdrv_save_vmstate    = qcow2_save_vmstate,
     .bdrv_load_vmstate    = qcow2_load_vmstate,
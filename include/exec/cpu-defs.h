@@ -158,7 +158,7 @@ typedef struct CPUTLBDesc {
     /*
      * Describe a region covering all of the large pages allocated
      * into the tlb.  When any page within this region is flushed,
-     * we must flush the entire tlb.  The region is matched if
+     * we must flush the entire region.  The region is matched if
      * (addr & large_page_mask) == large_page_addr.
      */
     target_ulong large_page_addr;
@@ -208,6 +208,9 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t fill_count;
+    size_t victim_hit_count;
+    size_t resize_count;
 } CPUTLBCommon;
 
 /*
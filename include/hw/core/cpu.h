@@ -364,6 +364,23 @@ struct CPUState {
     /* Accessed in parallel; all accesses must be atomic */
     TranslationBlock *tb_jmp_cache[TB_JMP_CACHE_SIZE];
 
+    /*
+     * TCG execution loop statistics.  These are only updated by the
+     * vCPU thread, outside of generated code, but are read and written
+     * atomically so that the monitor can print a snapshot.
+     */
+    struct {
+        size_t jmp_cache_hit;
+        size_t htable_hit;
+        size_t lookup_miss;
+        size_t goto_ptr_miss;
+        size_t exit_goto_tb;
+        size_t exit_tb;
+        size_t exit_requested;
+        /* a goto_ptr miss is returning through the epilogue */
+        bool goto_ptr_missed;
+    } tb_stats;
+
     struct GDBRegisterState *gdb_regs;
     int gdb_num_regs;
     int gdb_num_g_regs;
@@ -20,6 +20,7 @@
 #include "exec/gdbstub.h"
 #include "qemu.h"
 #include "user-internals.h"
+#include "tcg/perf.h"
 #ifdef CONFIG_GPROF
 #include <sys/gmon.h>
 #endif
@@ -38,4 +39,5 @@ void preexit_cleanup(CPUArchState *env, int code)
 #endif
         gdb_exit(code);
         qemu_plugin_user_exit();
+        perf_exit();
 }
@@ -0,0 +1,283 @@
+/*
+ * Multifd lz4 compression implementation
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include <lz4.h>
+#include "qemu/bswap.h"
+#include "qemu/rcu.h"
+#include "exec/ramblock.h"
+#include "exec/target_page.h"
+#include "qapi/error.h"
+#include "migration.h"
+#include "trace.h"
+#include "multifd.h"
+
+/*
+ * Each page is compressed as an independent lz4 block, preceded by its
+ * compressed length as a big endian 32-bit value.  A length equal to the
+ * page size means that the page did not compress and is stored as is.
+ *
+ * Unlike zstd, lz4 does not copy its input into a private window: a
+ * streaming compressor would reference the previous pages in guest
+ * memory, which the guest may change before the next page is compressed.
+ */
+typedef uint32_t lz4_hdr_t;
+
+struct lz4_data {
+    /* compression state, see LZ4_sizeofState() */
+    void *state;
+    /* stable copy of the page being compressed */
+    uint8_t *buf;
+    /* compressed buffer */
+    uint8_t *zbuff;
+    /* size of compressed buffer */
+    uint32_t zbuff_len;
+};
+
+/* Multifd lz4 compression */
+
+static uint32_t lz4_zbuff_len(void)
+{
+    size_t page_size = qemu_target_page_size();
+    uint32_t page_count = MULTIFD_PACKET_SIZE / page_size;
+
+    return page_count * (sizeof(lz4_hdr_t) + LZ4_compressBound(page_size));
+}
+
+/**
+ * lz4_send_setup: setup send side
+ *
+ * Setup each channel with lz4 compression.
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @errp: pointer to an error
+ */
+static int lz4_send_setup(MultiFDSendParams *p, Error **errp)
+{
+    struct lz4_data *z = g_new0(struct lz4_data, 1);
+
+    z->state = g_try_malloc(LZ4_sizeofState());
+    z->buf = g_try_malloc(qemu_target_page_size());
+    z->zbuff_len = lz4_zbuff_len();
+    z->zbuff = g_try_malloc(z->zbuff_len);
+    if (!z->state || !z->buf || !z->zbuff) {
+        g_free(z->state);
+        g_free(z->buf);
+        g_free(z->zbuff);
+        g_free(z);
+        error_setg(errp, "multifd %u: out of memory for lz4", p->id);
+        return -1;
+    }
+    p->data = z;
+    return 0;
+}
+
+/**
+ * lz4_send_cleanup: cleanup send side
+ *
+ * Return the memory.
+ *
+ * @p: Params for the channel that we are using
+ * @errp: pointer to an error
+ */
+static void lz4_send_cleanup(MultiFDSendParams *p, Error **errp)
+{
+    struct lz4_data *z = p->data;
+
+    g_free(z->state);
+    z->state = NULL;
+    g_free(z->buf);
+    z->buf = NULL;
+    g_free(z->zbuff);
+    z->zbuff = NULL;
+    g_free(p->data);
+    p->data = NULL;
+}
+
+/**
+ * lz4_send_prepare: prepare date to be able to send
+ *
+ * Create a compressed buffer with all the pages that we are going to
+ * send.
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @errp: pointer to an error
+ */
+static int lz4_send_prepare(MultiFDSendParams *p, Error **errp)
+{
+    struct lz4_data *z = p->data;
+    size_t page_size = qemu_target_page_size();
+    uint8_t *out = z->zbuff;
+    uint32_t i;
+
+    for (i = 0; i < p->normal_num; i++) {
+        char *dst = (char *)out + sizeof(lz4_hdr_t);
+        int len;
+
+        /*
+         * Since the VM might be running, the page may be changing concurrently
+         * with compression. lz4 does not guarantee that this is safe,
+         * therefore copy the page before compressing it.
+         */
+        memcpy(z->buf, p->pages->block->host + p->normal[i], page_size);
+
+        /* Anything that does not shrink the page is sent uncompressed. */
+        len = LZ4_compress_fast_extState(z->state, (const char *)z->buf, dst,
+                                         page_size, page_size - 1, 1);
+        if (len <= 0) {
+            memcpy(dst, z->buf, page_size);
+            len = page_size;
+        }
+        stl_be_p(out, len);
+        out += sizeof(lz4_hdr_t) + len;
+    }
+
+    p->iov[p->iovs_num].iov_base = z->zbuff;
+    p->iov[p->iovs_num].iov_len = out - z->zbuff;
+    p->iovs_num++;
+    p->next_packet_size = out - z->zbuff;
+    p->flags |= MULTIFD_FLAG_LZ4;
+
+    return 0;
+}
+
+/**
+ * lz4_recv_setup: setup receive side
+ *
+ * Create the compressed buffer.
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @errp: pointer to an error
+ */
+static int lz4_recv_setup(MultiFDRecvParams *p, Error **errp)
+{
+    struct lz4_data *z = g_new0(struct lz4_data, 1);
+
+    z->zbuff_len = lz4_zbuff_len();
+    z->zbuff = g_try_malloc(z->zbuff_len);
+    if (!z->zbuff) {
+        g_free(z);
+        error_setg(errp, "multifd %u: out of memory for zbuff", p->id);
+        return -1;
+    }
+    p->data = z;
+    return 0;
+}
+
+/**
+ * lz4_recv_cleanup: cleanup receive side
+ *
+ * Return the memory.
+ *
+ * @p: Params for the channel that we are using
+ */
+static void lz4_recv_cleanup(MultiFDRecvParams *p)
+{
+    struct lz4_data *z = p->data;
+
+    g_free(z->zbuff);
+    z->zbuff = NULL;
+    g_free(p->data);
+    p->data = NULL;
+}
+
+/**
+ * lz4_recv_pages: read the data from the channel into actual pages
+ *
+ * Read the compressed buffer, and uncompress it into the actual
+ * pages.
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @errp: pointer to an error
+ */
+static int lz4_recv_pages(MultiFDRecvParams *p, Error **errp)
+{
+    uint32_t in_size = p->next_packet_size;
+    size_t page_size = qemu_target_page_size();
+    uint32_t flags = p->flags & MULTIFD_FLAG_COMPRESSION_MASK;
+    struct lz4_data *z = p->data;
+    uint8_t *in = z->zbuff;
+    uint8_t *end;
+    uint32_t i;
+    int ret;
+
+    if (flags != MULTIFD_FLAG_LZ4) {
+        error_setg(errp, "multifd %u: flags received %x flags expected %x",
+                   p->id, flags, MULTIFD_FLAG_LZ4);
+        return -1;
+    }
+    if (in_size > z->zbuff_len) {
+        error_setg(errp, "multifd %u: packet size received %u max size %u",
+                   p->id, in_size, z->zbuff_len);
+        return -1;
+    }
+    ret = qio_channel_read_all(p->c, (void *)z->zbuff, in_size, errp);
+    if (ret != 0) {
+        return ret;
+    }
+
+    end = z->zbuff + in_size;
+    for (i = 0; i < p->normal_num; i++) {
+        uint8_t *page = p->host + p->normal[i];
+        uint32_t len;
+
+        if (end - in < sizeof(lz4_hdr_t)) {
+            break;
+        }
+        len = ldl_be_p(in);
+        in += sizeof(lz4_hdr_t);
+        if (len > page_size || len > end - in) {
+            break;
+        }
+
+        if (len == page_size) {
+            memcpy(page, in, page_size);
+        } else {
+            ret = LZ4_decompress_safe((const char *)in, (char *)page,
+                                      len, page_size);
+            if (ret != page_size) {
+                error_setg(errp, "multifd %u: lz4 decompression of page %u "
+                           "returned %d", p->id, i, ret);
+                return -1;
+            }
+        }
+        in += len;
+    }
+
+    if (i != p->normal_num || in != end) {
+        error_setg(errp, "multifd %u: malformed lz4 packet, "
+                   "%u of %u pages, %u of %u bytes",
+                   p->id, i, p->normal_num,
+                   (uint32_t)(in - z->zbuff), in_size);
+        return -1;
+    }
+    return 0;
+}
+
+static MultiFDMethods multifd_lz4_ops = {
+    .send_setup = lz4_send_setup,
+    .send_cleanup = lz4_send_cleanup,
+    .send_prepare = lz4_send_prepare,
+    .recv_setup = lz4_recv_setup,
+    .recv_cleanup = lz4_recv_cleanup,
+    .recv_pages = lz4_recv_pages
+};
+
+static void multifd_lz4_register(void)
+{
+    multifd_register_ops(MULTIFD_COMPRESSION_LZ4, &multifd_lz4_ops);
+}
+
+migration_init(multifd_lz4_register);
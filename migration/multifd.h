@@ -32,6 +32,7 @@ int multifd_queue_page(QEMUFile *f, RAMBlock *block, ram_addr_t offset);
 #define MULTIFD_FLAG_NOCOMP (0 << 1)
 #define MULTIFD_FLAG_ZLIB (1 << 1)
 #define MULTIFD_FLAG_ZSTD (2 << 1)
+#define MULTIFD_FLAG_LZ4 (3 << 1)
 
 /* This value needs to be a multiple of qemu_target_page_size() */
 #define MULTIFD_PACKET_SIZE (512 * 1024)
@@ -47,8 +48,15 @@ typedef struct {
     /* size of the next packet that contains pages */
     uint32_t next_packet_size;
     uint64_t packet_num;
-    uint64_t unused[4];    /* Reserved for future use */
+    /* zero pages, only with the multifd-zero-pages capability */
+    uint32_t zero_pages;
+    uint32_t unused32[1];  /* Reserved for future use */
+    uint64_t unused64[3];  /* Reserved for future use */
     char ramblock[256];
+    /*
+     * normal_pages offsets of pages whose data follows the packet,
+     * then zero_pages offsets of pages that must be zeroed.
+     */
     uint64_t offset[];
 } __attribute__((packed)) MultiFDPacket_t;
 
@@ -100,6 +108,8 @@ typedef struct {
     uint64_t packet_num;
     /* thread has work to do */
     int pending_job;
+    /* bytes sent but not yet charged to the migration rate limit */
+    uint64_t pending_bytes;
     /* array of pages to sent.
      * The owner of 'pages' depends of 'pending_job' value:
      * pending_job == 0 -> migration_thread can use it.
@@ -117,6 +127,10 @@ typedef struct {
     uint64_t num_packets;
     /* non zero pages sent through this channel */
     uint64_t total_normal_pages;
+    /* zero pages found by this channel */
+    uint64_t total_zero_pages;
+    /* bytes written to this channel, packet headers included */
+    uint64_t total_bytes;
     /* buffers to send */
     struct iovec *iov;
     /* number of iovs used */
@@ -125,6 +139,10 @@ typedef struct {
     ram_addr_t *normal;
     /* num of non zero pages */
     uint32_t normal_num;
+    /* Pages that are zero */
+    ram_addr_t *zero;
+    /* num of zero pages */
+    uint32_t zero_num;
     /* used for compression methods */
     void *data;
 }  MultiFDSendParams;
@@ -170,12 +188,20 @@ typedef struct {
     uint8_t *host;
     /* non zero pages recv through this channel */
     uint64_t total_normal_pages;
+    /* zero pages recv through this channel */
+    uint64_t total_zero_pages;
+    /* bytes read from this channel, packet headers included */
+    uint64_t total_bytes;
     /* buffers to recv */
     struct iovec *iov;
     /* Pages that are not zero */
     ram_addr_t *normal;
     /* num of non zero pages */
     uint32_t normal_num;
+    /* Pages that are zero */
+    ram_addr_t *zero;
+    /* num of zero pages */
+    uint32_t zero_num;
     /* used for de-compression methods */
     void *data;
 } MultiFDRecvParams;
@@ -709,10 +709,62 @@ int postcopy_wake_shared(struct PostCopyFD *pcfd,
     return ret;
 }
 
+/*
+ * Ask the source for the pages following a fault at @start, if faults in
+ * @rb have been moving forward by less than the prefetch window, as when
+ * the guest walks through a buffer.  Scattered faults only request the
+ * pages they touch, so that prefetch does not delay other faults behind
+ * pages that nobody needs.
+ *
+ * The source skips pages that it has already sent, so overlapping with
+ * pages in flight only costs a few bits of the request.
+ */
+static void postcopy_prefetch_pages(MigrationIncomingState *mis,
+                                    RAMBlock *rb, ram_addr_t start)
+{
+    uint64_t window = migrate_postcopy_prefetch_window();
+    size_t psize = qemu_ram_pagesize(rb);
+    uint64_t span;
+    ram_addr_t end;
+    bool sequential;
+
+    if (!window) {
+        return;
+    }
+
+    sequential = rb == mis->prefetch_rb && start > mis->prefetch_fault &&
+                 start - mis->prefetch_fault <= window * psize;
+    if (rb != mis->prefetch_rb) {
+        mis->prefetch_end = 0;
+    }
+    mis->prefetch_rb = rb;
+    mis->prefetch_fault = start;
+    if (!sequential) {
+        return;
+    }
+
+    /* The request carries its length as a 32-bit value */
+    span = MIN(psize * (window + 1), QEMU_ALIGN_DOWN(UINT32_MAX, psize));
+    end = MIN(start + span, qemu_ram_get_used_length(rb));
+    start = MAX(start + psize, mis->prefetch_end);
+    while (start < end && ramblock_recv_bitmap_test_byte_offset(rb, start)) {
+        start += psize;
+    }
+    if (start >= end) {
+        return;
+    }
+
+    trace_postcopy_prefetch_pages(qemu_ram_get_idstr(rb), start, end - start);
+    if (!migrate_send_rp_message_req_pages(mis, rb, start, end - start)) {
+        mis->prefetch_end = end;
+    }
+}
+
 static int postcopy_request_page(MigrationIncomingState *mis, RAMBlock *rb,
                                  ram_addr_t start, uint64_t haddr)
 {
     void *aligned = (void *)(uintptr_t)ROUND_DOWN(haddr, qemu_ram_pagesize(rb));
+    int ret;
 
     /*
      * Discarded pages (via RamDiscardManager) are never migrated. On unlikely
@@ -729,7 +781,11 @@ static int postcopy_request_page(MigrationIncomingState *mis, RAMBlock *rb,
         return received ? 0 : postcopy_place_page_zero(mis, aligned, rb);
     }
 
-    return migrate_send_rp_req_pages(mis, rb, start, haddr);
+    ret = migrate_send_rp_req_pages(mis, rb, start, haddr);
+    if (!ret) {
+        postcopy_prefetch_pages(mis, rb, start);
+    }
+    return ret;
 }
 
 /*
@@ -921,6 +977,7 @@ static void *postcopy_ram_fault_thread(void *opaque)
     trace_postcopy_ram_fault_thread_entry();
     rcu_register_thread();
     mis->last_rb = NULL; /* last RAMBlock we sent part of */
+    mis->prefetch_rb = NULL;
     qemu_sem_post(&mis->thread_sync_sem);
 
     struct pollfd *pfd;
@@ -713,6 +713,12 @@ int64_t qemu_file_total_transferred_fast(QEMUFile *f)
     return ret;
 }
 
+int64_t qemu_file_total_consumed(QEMUFile *f)
+{
+    assert(!qemu_file_is_writable(f));
+    return f->total_transferred - (f->buf_size - f->buf_index);
+}
+
 int64_t qemu_file_total_transferred(QEMUFile *f)
 {
     qemu_fflush(f);
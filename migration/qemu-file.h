@@ -97,6 +97,17 @@ int64_t qemu_file_total_transferred(QEMUFile *f);
  */
 int64_t qemu_file_total_transferred_fast(QEMUFile *f);
 
+/*
+ * qemu_file_total_consumed:
+ *
+ * For readable files, report the number of bytes that
+ * have been read by the caller, i.e. the amount received
+ * on the wire minus whatever is still buffered.
+ *
+ * Returns: the total bytes consumed
+ */
+int64_t qemu_file_total_consumed(QEMUFile *f);
+
 /*
  * put_buffer without copying the buffer.
  * The buffer should be available till it is sent asynchronously.
@@ -99,6 +99,9 @@ static struct {
     uint8_t *zero_target_page;
     /* buffer used for XBZRLE decoding */
     uint8_t *decoded_buf;
+    /* encoder, chosen at init time from the host CPU features */
+    int (*encode_buffer)(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                         uint8_t *dst, int dlen);
 } XBZRLE;
 
 static void XBZRLE_cache_lock(void)
@@ -421,6 +424,7 @@ uint64_t ram_bytes_remaining(void)
 }
 
 MigrationStats ram_counters;
+MigrationAtomicStats ram_atomic_counters;
 
 static void ram_transferred_add(uint64_t bytes)
 {
@@ -431,7 +435,7 @@ static void ram_transferred_add(uint64_t bytes)
     } else {
         ram_counters.downtime_bytes += bytes;
     }
-    ram_counters.transferred += bytes;
+    stat64_add(&ram_atomic_counters.transferred, bytes);
 }
 
 void dirty_sync_missed_zero_copy(void)
@@ -713,13 +717,76 @@ static void mig_throttle_guest_down(uint64_t bytes_dirty_period,
     }
 }
 
+/*
+ * Below this fraction of the dirty rate threshold, the adaptive throttle
+ * is allowed to back off.  The margin keeps it from oscillating around
+ * the threshold.
+ */
+#define THROTTLE_ADAPTIVE_RELAX_RATIO 0.8
+
+/**
+ * mig_throttle_guest_adaptive: set the guest throttle from the dirty rate
+ *
+ * Closed-loop variant of mig_throttle_guest_down(), run at every bitmap
+ * sync period.  Assuming that the guest dirties memory in proportion to
+ * the CPU time it is given, compute the throttle that brings the dirty
+ * rate down to the threshold and apply it directly.  When the dirty rate
+ * is comfortably below the threshold, give CPU time back to the guest,
+ * at most @cpu-throttle-increment percent per period.
+ *
+ * @bytes_dirty_period: bytes dirtied in the last period
+ * @bytes_dirty_threshold: dirty bytes that the transfer rate can absorb
+ */
+static void mig_throttle_guest_adaptive(uint64_t bytes_dirty_period,
+                                        uint64_t bytes_dirty_threshold)
+{
+    MigrationState *s = migrate_get_current();
+    int pct_increment = s->parameters.cpu_throttle_increment;
+    int pct_max = s->parameters.max_cpu_throttle;
+    int throttle_now = 0;
+    int throttle_new;
+    double ratio;
+
+    if (cpu_throttle_active()) {
+        throttle_now = cpu_throttle_get_percentage();
+    }
+
+    /* Nothing was sent in this period, so there is nothing to compare to. */
+    if (!bytes_dirty_threshold) {
+        return;
+    }
+
+    ratio = (double)bytes_dirty_period / bytes_dirty_threshold;
+    if (ratio > 1) {
+        throttle_new = 100 - (100 - throttle_now) / ratio;
+    } else if (ratio < THROTTLE_ADAPTIVE_RELAX_RATIO) {
+        throttle_new = MAX(throttle_now - pct_increment, 0);
+    } else {
+        throttle_new = throttle_now;
+    }
+    throttle_new = MIN(throttle_new, pct_max);
+
+    if (throttle_new == throttle_now) {
+        return;
+    }
+
+    trace_migration_throttle_adaptive(bytes_dirty_period,
+                                      bytes_dirty_threshold,
+                                      throttle_now, throttle_new);
+    if (throttle_new > 0) {
+        cpu_throttle_set(throttle_new);
+    } else {
+        cpu_throttle_stop();
+    }
+}
+
 void mig_throttle_counter_reset(void)
 {
     RAMState *rs = ram_state;
 
     rs->time_last_bitmap_sync = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
     rs->num_dirty_pages_period = 0;
-    rs->bytes_xfer_prev = ram_counters.transferred;
+    rs->bytes_xfer_prev = stat64_get(&ram_atomic_counters.transferred);
 }
 
 /**
@@ -802,7 +869,7 @@ static int save_xbzrle_page(RAMState *rs, uint8_t **current_data,
     memcpy(XBZRLE.current_buf, *current_data, TARGET_PAGE_SIZE);
 
     /* XBZRLE encoding (if there is no overflow) */
-    encoded_len = xbzrle_encode_buffer(prev_cached_page, XBZRLE.current_buf,
+    encoded_len = XBZRLE.encode_buffer(prev_cached_page, XBZRLE.current_buf,
                                        TARGET_PAGE_SIZE, XBZRLE.encoded_buf,
                                        TARGET_PAGE_SIZE);
 
@@ -1083,8 +1150,9 @@ uint64_t ram_pagesize_summary(void)
 
 uint64_t ram_get_total_transferred_pages(void)
 {
-    return  ram_counters.normal + ram_counters.duplicate +
-                compression_counters.pages + xbzrle_counters.pages;
+    return stat64_get(&ram_atomic_counters.normal) +
+        stat64_get(&ram_atomic_counters.duplicate) +
+        compression_counters.pages + xbzrle_counters.pages;
 }
 
 static void migration_update_rates(RAMState *rs, int64_t end_time)
@@ -1144,7 +1212,8 @@ static void migration_trigger_throttle(RAMState *rs)
     MigrationState *s = migrate_get_current();
     uint64_t threshold = s->parameters.throttle_trigger_threshold;
 
-    uint64_t bytes_xfer_period = ram_counters.transferred - rs->bytes_xfer_prev;
+    uint64_t bytes_xfer_period =
+        stat64_get(&ram_atomic_counters.transferred) - rs->bytes_xfer_prev;
     uint64_t bytes_dirty_period = rs->num_dirty_pages_period * TARGET_PAGE_SIZE;
     uint64_t bytes_dirty_threshold = bytes_xfer_period * threshold / 100;
 
@@ -1152,6 +1221,12 @@ static void migration_trigger_throttle(RAMState *rs)
      * that ram migration makes no progress. Avoid this by disabling the
      * throttling logic during the bulk phase of block migration. */
     if (migrate_auto_converge() && !blk_mig_bulk_active()) {
+        if (s->parameters.cpu_throttle_adaptive) {
+            mig_throttle_guest_adaptive(bytes_dirty_period,
+                                        bytes_dirty_threshold);
+            return;
+        }
+
         /* The following detection logic can be refined later. For now:
            Check to see if the ratio between dirtied bytes and the approx.
            amount of bytes that just got transferred since the last time
@@ -1207,7 +1282,7 @@ static void migration_bitmap_sync(RAMState *rs)
         /* reset period counters */
         rs->time_last_bitmap_sync = end_time;
         rs->num_dirty_pages_period = 0;
-        rs->bytes_xfer_prev = ram_counters.transferred;
+        rs->bytes_xfer_prev = stat64_get(&ram_atomic_counters.transferred);
     }
     if (migrate_use_events()) {
         qapi_event_send_migration_pass(ram_counters.dirty_sync_count);
@@ -1283,7 +1358,7 @@ static int save_zero_page(RAMState *rs, RAMBlock *block, ram_addr_t offset)
     int len = save_zero_page_to_file(rs, rs->f, block, offset);
 
     if (len) {
-        ram_counters.duplicate++;
+        stat64_add(&ram_atomic_counters.duplicate, 1);
         ram_transferred_add(len);
         return 1;
     }
@@ -1320,9 +1395,9 @@ static bool control_save_page(RAMState *rs, RAMBlock *block, ram_addr_t offset,
     }
 
     if (bytes_xmit > 0) {
-        ram_counters.normal++;
+        stat64_add(&ram_atomic_counters.normal, 1);
     } else if (bytes_xmit == 0) {
-        ram_counters.duplicate++;
+        stat64_add(&ram_atomic_counters.duplicate, 1);
     }
 
     return true;
@@ -1352,7 +1427,7 @@ static int save_normal_page(RAMState *rs, RAMBlock *block, ram_addr_t offset,
         qemu_put_buffer(rs->f, buf, TARGET_PAGE_SIZE);
     }
     ram_transferred_add(TARGET_PAGE_SIZE);
-    ram_counters.normal++;
+    stat64_add(&ram_atomic_counters.normal, 1);
     return 1;
 }
 
@@ -1408,7 +1483,6 @@ static int ram_save_multifd_page(RAMState *rs, RAMBlock *block,
     if (multifd_queue_page(rs->f, block, offset) < 0) {
         return -1;
     }
-    ram_counters.normal++;
 
     return 1;
 }
@@ -1446,7 +1520,7 @@ update_compress_thread_counts(const CompressParam *param, int bytes_xmit)
     ram_transferred_add(bytes_xmit);
 
     if (param->zero_page) {
-        ram_counters.duplicate++;
+        stat64_add(&ram_atomic_counters.duplicate, 1);
         return;
     }
 
@@ -2170,6 +2244,7 @@ int ram_save_queue_pages(const char *rbname, ram_addr_t start, ram_addr_t len)
     RAMState *rs = ram_state;
 
     ram_counters.postcopy_requests++;
+    ram_counters.postcopy_requested_bytes += len;
     RCU_READ_LOCK_GUARD();
 
     if (!rbname) {
@@ -2291,6 +2366,15 @@ static int ram_save_target_page(RAMState *rs, PageSearchStatus *pss)
         return 1;
     }
 
+    /*
+     * With multifd-zero-pages the channel threads look for zero pages,
+     * so the migration thread does not scan them here.
+     */
+    if (migrate_use_multifd_zero_pages() && !save_page_use_compression(rs) &&
+        !migration_in_postcopy()) {
+        return ram_save_multifd_page(rs, block, offset);
+    }
+
     res = save_zero_page(rs, block, offset);
     if (res > 0) {
         /* Must let xbzrle know, otherwise a previous (now 0'd) cached
@@ -2588,9 +2672,9 @@ void acct_update_position(QEMUFile *f, size_t size, bool zero)
     uint64_t pages = size / TARGET_PAGE_SIZE;
 
     if (zero) {
-        ram_counters.duplicate += pages;
+        stat64_add(&ram_atomic_counters.duplicate, pages);
     } else {
-        ram_counters.normal += pages;
+        stat64_add(&ram_atomic_counters.normal, pages);
         ram_transferred_add(size);
         qemu_file_credit_transfer(f, size);
     }
@@ -2944,6 +3028,13 @@ static int xbzrle_init(void)
 
     XBZRLE_cache_lock();
 
+    XBZRLE.encode_buffer = xbzrle_encode_buffer;
+#ifdef CONFIG_AVX2_OPT
+    if (__builtin_cpu_supports("avx2")) {
+        XBZRLE.encode_buffer = xbzrle_encode_buffer_avx2;
+    }
+#endif
+
     XBZRLE.zero_target_page = g_try_malloc0(TARGET_PAGE_SIZE);
     if (!XBZRLE.zero_target_page) {
         error_report("%s: Error allocating zero page", __func__);
@@ -32,6 +32,20 @@
 #include "qapi/qapi-types-migration.h"
 #include "exec/cpu-common.h"
 #include "io/channel.h"
+#include "qemu/stats64.h"
+
+/*
+ * These counters are also updated by the multifd send threads, so they
+ * cannot be plain fields of ram_counters.
+ */
+typedef struct {
+    Stat64 transferred;
+    Stat64 duplicate;
+    Stat64 normal;
+    Stat64 multifd_bytes;
+} MigrationAtomicStats;
+
+extern MigrationAtomicStats ram_atomic_counters;
 
 extern MigrationStats ram_counters;
 extern XBZRLECacheStats xbzrle_counters;
@@ -867,6 +867,20 @@ void vmstate_unregister(VMStateIf *obj, const VMStateDescription *vmsd,
     }
 }
 
+/*
+ * The vmstate_downtime_* trace events split the downtime by section: the
+ * source reports every section saved after the VM has stopped, and the
+ * destination the FULL and END sections it loads, which are the ones the
+ * source saved while stopped.  Each comes with the bytes that went through
+ * the main migration stream and the time spent in microseconds.  Pages
+ * sent over multifd channels are not part of the byte count, but waiting
+ * for them is part of the time spent in the RAM section.
+ */
+static const char *vmstate_downtime_type(SaveStateEntry *se)
+{
+    return se->ops && se->ops->save_live_iterate ? "iterable" : "non-iterable";
+}
+
 static int vmstate_load(QEMUFile *f, SaveStateEntry *se)
 {
     trace_vmstate_load(se->idstr, se->vmsd ? se->vmsd->name : "(old)");
@@ -1328,6 +1342,9 @@ void qemu_savevm_state_complete_postcopy(QEMUFile *f)
 static
 int qemu_savevm_state_complete_precopy_iterable(QEMUFile *f, bool in_postcopy)
 {
+    bool trace_downtime = trace_event_get_state_backends(
+                              TRACE_VMSTATE_DOWNTIME_SAVE);
+    int64_t start_time = 0, start_bytes = 0;
     SaveStateEntry *se;
     int ret;
 
@@ -1345,6 +1362,10 @@ int qemu_savevm_state_complete_precopy_iterable(QEMUFile *f, bool in_postcopy)
             }
         }
         trace_savevm_section_start(se->idstr, se->section_id);
+        if (trace_downtime) {
+            start_time = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+            start_bytes = qemu_file_total_transferred_fast(f);
+        }
 
         save_section_header(f, se, QEMU_VM_SECTION_END);
 
@@ -1355,6 +1376,13 @@ int qemu_savevm_state_complete_precopy_iterable(QEMUFile *f, bool in_postcopy)
             qemu_file_set_error(f, ret);
             return -1;
         }
+
+        if (trace_downtime) {
+            trace_vmstate_downtime_save(vmstate_downtime_type(se), se->idstr,
+                se->instance_id,
+                qemu_file_total_transferred_fast(f) - start_bytes,
+                qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start_time);
+        }
     }
 
     return 0;
@@ -1365,6 +1393,9 @@ int qemu_savevm_state_complete_precopy_non_iterable(QEMUFile *f,
                                                     bool inactivate_disks)
 {
     g_autoptr(JSONWriter) vmdesc = NULL;
+    bool trace_downtime = trace_event_get_state_backends(
+                              TRACE_VMSTATE_DOWNTIME_SAVE);
+    int64_t start_time = 0, start_bytes = 0;
     int vmdesc_len;
     SaveStateEntry *se;
     int ret;
@@ -1384,6 +1415,10 @@ int qemu_savevm_state_complete_precopy_non_iterable(QEMUFile *f,
         }
 
         trace_savevm_section_start(se->idstr, se->section_id);
+        if (trace_downtime) {
+            start_time = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+            start_bytes = qemu_file_total_transferred_fast(f);
+        }
 
         json_writer_start_object(vmdesc, NULL);
         json_writer_str(vmdesc, "name", se->idstr);
@@ -1399,6 +1434,13 @@ int qemu_savevm_state_complete_precopy_non_iterable(QEMUFile *f,
         save_section_footer(f, se);
 
         json_writer_end_object(vmdesc);
+
+        if (trace_downtime) {
+            trace_vmstate_downtime_save(vmstate_downtime_type(se), se->idstr,
+                se->instance_id,
+                qemu_file_total_transferred_fast(f) - start_bytes,
+                qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start_time);
+        }
     }
 
     if (inactivate_disks) {
@@ -1450,6 +1492,7 @@ int qemu_savevm_state_complete_precopy(QEMUFile *f, bool iterable_only,
         if (ret) {
             return ret;
         }
+        trace_vmstate_downtime_checkpoint("src-iterable-saved");
     }
 
     if (iterable_only) {
@@ -1461,6 +1504,7 @@ int qemu_savevm_state_complete_precopy(QEMUFile *f, bool iterable_only,
     if (ret) {
         return ret;
     }
+    trace_vmstate_downtime_checkpoint("src-non-iterable-saved");
 
 flush:
     qemu_fflush(f);
@@ -1533,6 +1577,7 @@ static int qemu_savevm_state(QEMUFile *f, Error **errp)
 
     migrate_init(ms);
     memset(&ram_counters, 0, sizeof(ram_counters));
+    memset(&ram_atomic_counters, 0, sizeof(ram_atomic_counters));
     memset(&compression_counters, 0, sizeof(compression_counters));
     ms->to_dst_file = f;
 
@@ -2050,7 +2095,8 @@ static gboolean postcopy_sync_page_req(gpointer key, gpointer value,
         return FALSE;
     }
 
-    ret = migrate_send_rp_message_req_pages(mis, rb, rb_offset);
+    ret = migrate_send_rp_message_req_pages(mis, rb, rb_offset,
+                                            qemu_ram_pagesize(rb));
     if (ret) {
         /* Please refer to above comment. */
         error_report("%s: send rp message failed for addr %p",
@@ -2080,9 +2126,11 @@ static int loadvm_postcopy_handle_resume(MigrationIncomingState *mis)
 
     /*
      * Reset the last_rb before we resend any page req to source again, since
-     * the source should have it reset already.
+     * the source should have it reset already.  Prefetches that were in
+     * flight may have been lost, so start over with those too.
      */
     mis->last_rb = NULL;
+    mis->prefetch_rb = NULL;
 
     /*
      * This means source VM is ready to resume the postcopy migration.
@@ -2363,8 +2411,12 @@ static bool check_section_footer(QEMUFile *f, SaveStateEntry *se)
 }
 
 static int
-qemu_loadvm_section_start_full(QEMUFile *f, MigrationIncomingState *mis)
+qemu_loadvm_section_start_full(QEMUFile *f, MigrationIncomingState *mis,
+                               uint8_t type)
 {
+    bool trace_downtime = type == QEMU_VM_SECTION_FULL &&
+        trace_event_get_state_backends(TRACE_VMSTATE_DOWNTIME_LOAD);
+    int64_t start_time = 0, start_bytes = 0;
     uint32_t instance_id, version_id, section_id;
     SaveStateEntry *se;
     char idstr[256];
@@ -2414,6 +2466,11 @@ qemu_loadvm_section_start_full(QEMUFile *f, MigrationIncomingState *mis)
         return -EINVAL;
     }
 
+    if (trace_downtime) {
+        start_time = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+        start_bytes = qemu_file_total_consumed(f);
+    }
+
     ret = vmstate_load(f, se);
     if (ret < 0) {
         error_report("error while loading state for instance 0x%"PRIx32" of"
@@ -2424,12 +2481,22 @@ qemu_loadvm_section_start_full(QEMUFile *f, MigrationIncomingState *mis)
         return -EINVAL;
     }
 
+    if (trace_downtime) {
+        trace_vmstate_downtime_load(vmstate_downtime_type(se), se->idstr,
+            se->instance_id, qemu_file_total_consumed(f) - start_bytes,
+            qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start_time);
+    }
+
     return 0;
 }
 
 static int
-qemu_loadvm_section_part_end(QEMUFile *f, MigrationIncomingState *mis)
+qemu_loadvm_section_part_end(QEMUFile *f, MigrationIncomingState *mis,
+                             uint8_t type)
 {
+    bool trace_downtime = type == QEMU_VM_SECTION_END &&
+        trace_event_get_state_backends(TRACE_VMSTATE_DOWNTIME_LOAD);
+    int64_t start_time = 0, start_bytes = 0;
     uint32_t section_id;
     SaveStateEntry *se;
     int ret;
@@ -2454,6 +2521,11 @@ qemu_loadvm_section_part_end(QEMUFile *f, MigrationIncomingState *mis)
         return -EINVAL;
     }
 
+    if (trace_downtime) {
+        start_time = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+        start_bytes = qemu_file_total_consumed(f);
+    }
+
     ret = vmstate_load(f, se);
     if (ret < 0) {
         error_report("error while loading state section id %d(%s)",
@@ -2464,6 +2536,12 @@ qemu_loadvm_section_part_end(QEMUFile *f, MigrationIncomingState *mis)
         return -EINVAL;
     }
 
+    if (trace_downtime) {
+        trace_vmstate_downtime_load(vmstate_downtime_type(se), se->idstr,
+            se->instance_id, qemu_file_total_consumed(f) - start_bytes,
+            qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start_time);
+    }
+
     return 0;
 }
 
@@ -2630,14 +2708,14 @@ retry:
         switch (section_type) {
         case QEMU_VM_SECTION_START:
         case QEMU_VM_SECTION_FULL:
-            ret = qemu_loadvm_section_start_full(f, mis);
+            ret = qemu_loadvm_section_start_full(f, mis, section_type);
             if (ret < 0) {
                 goto out;
             }
             break;
         case QEMU_VM_SECTION_PART:
         case QEMU_VM_SECTION_END:
-            ret = qemu_loadvm_section_part_end(f, mis);
+            ret = qemu_loadvm_section_part_end(f, mis, section_type);
             if (ret < 0) {
                 goto out;
             }
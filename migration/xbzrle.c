@@ -12,6 +12,7 @@
  */
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
+#include "qemu/host-utils.h"
 #include "xbzrle.h"
 
 /*
@@ -126,6 +127,87 @@ int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
     return d;
 }
 
+#ifdef CONFIG_AVX2_OPT
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#include <immintrin.h>
+
+/*
+ * Return the index of the first byte at or after @i whose equality
+ * between @old_buf and @new_buf differs from @equal, or @slen if none.
+ */
+static inline int xbzrle_run_end_avx2(const uint8_t *old_buf,
+                                      const uint8_t *new_buf,
+                                      int i, int slen, bool equal)
+{
+    while (i + 32 <= slen) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(old_buf + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(new_buf + i));
+        uint32_t eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+        uint32_t stop = equal ? ~eq : eq;
+
+        if (stop) {
+            return i + ctz32(stop);
+        }
+        i += 32;
+    }
+    while (i < slen && (old_buf[i] == new_buf[i]) == equal) {
+        i++;
+    }
+    return i;
+}
+
+/*
+ * Same encoding as xbzrle_encode_buffer(), and byte for byte the same
+ * output, but finding the end of each run 32 bytes at a time.
+ */
+int xbzrle_encode_buffer_avx2(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                              uint8_t *dst, int dlen)
+{
+    int d = 0, i = 0;
+
+    g_assert(!(((uintptr_t)old_buf | (uintptr_t)new_buf | slen) %
+               sizeof(long)));
+
+    while (i < slen) {
+        int end, nzrun_len;
+
+        /* overflow */
+        if (d + 2 > dlen) {
+            return -1;
+        }
+
+        /* zrun; a page without changes, or the last zrun, is not encoded */
+        end = xbzrle_run_end_avx2(old_buf, new_buf, i, slen, true);
+        if (end == slen) {
+            return d;
+        }
+        d += uleb128_encode_small(dst + d, end - i);
+        i = end;
+
+        /* overflow */
+        if (d + 2 > dlen) {
+            return -1;
+        }
+
+        /* nzrun */
+        end = xbzrle_run_end_avx2(old_buf, new_buf, i, slen, false);
+        nzrun_len = end - i;
+        d += uleb128_encode_small(dst + d, nzrun_len);
+        /* overflow */
+        if (d + nzrun_len > dlen) {
+            return -1;
+        }
+        memcpy(dst + d, new_buf + i, nzrun_len);
+        d += nzrun_len;
+        i = end;
+    }
+
+    return d;
+}
+#pragma GCC pop_options
+#endif /* CONFIG_AVX2_OPT */
+
 int xbzrle_decode_buffer(uint8_t *src, int slen, uint8_t *dst, int dlen)
 {
     int i = 0, d = 0;
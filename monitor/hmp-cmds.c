@@ -295,6 +295,10 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
             monitor_printf(mon, "postcopy request count: %" PRIu64 "\n",
                            info->ram->postcopy_requests);
         }
+        if (info->ram->postcopy_requested_bytes) {
+            monitor_printf(mon, "postcopy requested: %" PRIu64 " kbytes\n",
+                           info->ram->postcopy_requested_bytes >> 10);
+        }
         if (info->ram->precopy_bytes) {
             monitor_printf(mon, "precopy ram: %" PRIu64 " kbytes\n",
                            info->ram->precopy_bytes >> 10);
@@ -463,6 +467,10 @@ void hmp_info_migrate_parameters(Monitor *mon, const QDict *qdict)
         monitor_printf(mon, "%s: %s\n",
             MigrationParameter_str(MIGRATION_PARAMETER_CPU_THROTTLE_TAILSLOW),
             params->cpu_throttle_tailslow ? "on" : "off");
+        assert(params->has_cpu_throttle_adaptive);
+        monitor_printf(mon, "%s: %s\n",
+            MigrationParameter_str(MIGRATION_PARAMETER_CPU_THROTTLE_ADAPTIVE),
+            params->cpu_throttle_adaptive ? "on" : "off");
         assert(params->has_max_cpu_throttle);
         monitor_printf(mon, "%s: %u\n",
             MigrationParameter_str(MIGRATION_PARAMETER_MAX_CPU_THROTTLE),
@@ -503,6 +511,11 @@ void hmp_info_migrate_parameters(Monitor *mon, const QDict *qdict)
         monitor_printf(mon, "%s: %" PRIu64 "\n",
             MigrationParameter_str(MIGRATION_PARAMETER_MAX_POSTCOPY_BANDWIDTH),
             params->max_postcopy_bandwidth);
+        assert(params->has_postcopy_prefetch_window);
+        monitor_printf(mon, "%s: %u\n",
+            MigrationParameter_str(
+                MIGRATION_PARAMETER_POSTCOPY_PREFETCH_WINDOW),
+            params->postcopy_prefetch_window);
         monitor_printf(mon, "%s: '%s'\n",
             MigrationParameter_str(MIGRATION_PARAMETER_TLS_AUTHZ),
             params->tls_authz);
@@ -1251,6 +1264,10 @@ void hmp_migrate_set_parameter(Monitor *mon, const QDict *qdict)
         p->has_cpu_throttle_tailslow = true;
         visit_type_bool(v, param, &p->cpu_throttle_tailslow, &err);
         break;
+    case MIGRATION_PARAMETER_CPU_THROTTLE_ADAPTIVE:
+        p->has_cpu_throttle_adaptive = true;
+        visit_type_bool(v, param, &p->cpu_throttle_adaptive, &err);
+        break;
     case MIGRATION_PARAMETER_MAX_CPU_THROTTLE:
         p->has_max_cpu_throttle = true;
         visit_type_uint8(v, param, &p->max_cpu_throttle, &err);
@@ -1331,6 +1348,10 @@ void hmp_migrate_set_parameter(Monitor *mon, const QDict *qdict)
         p->has_max_postcopy_bandwidth = true;
         visit_type_size(v, param, &p->max_postcopy_bandwidth, &err);
         break;
+    case MIGRATION_PARAMETER_POSTCOPY_PREFETCH_WINDOW:
+        p->has_postcopy_prefetch_window = true;
+        visit_type_uint16(v, param, &p->postcopy_prefetch_window, &err);
+        break;
     case MIGRATION_PARAMETER_ANNOUNCE_INITIAL:
         p->has_announce_initial = true;
         visit_type_size(v, param, &p->announce_initial, &err);
@@ -116,6 +116,7 @@ meson_options_help() {
   printf "%s\n" '  live-block-migration'
   printf "%s\n" '                  block migration in the main migration stream'
   printf "%s\n" '  lzfse           lzfse support for DMG images'
+  printf "%s\n" '  lz4             lz4 compression support'
   printf "%s\n" '  lzo             lzo compression support'
   printf "%s\n" '  malloc-trim     enable libc malloc_trim() for memory optimization'
   printf "%s\n" '  membarrier      membarrier system call (for Linux 4.14+ or Windows'
@@ -322,6 +323,8 @@ _meson_option_parse() {
     --localstatedir=*) quote_sh "-Dlocalstatedir=$2" ;;
     --enable-lzfse) printf "%s" -Dlzfse=enabled ;;
     --disable-lzfse) printf "%s" -Dlzfse=disabled ;;
+    --enable-lz4) printf "%s" -Dlz4=enabled ;;
+    --disable-lz4) printf "%s" -Dlz4=disabled ;;
     --enable-lzo) printf "%s" -Dlzo=enabled ;;
     --disable-lzo) printf "%s" -Dlzo=disabled ;;
     --enable-malloc=*) quote_sh "-Dmalloc=$2" ;;
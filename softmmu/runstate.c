@@ -58,6 +58,7 @@
 #include "sysemu/runstate-action.h"
 #include "sysemu/sysemu.h"
 #include "sysemu/tpm.h"
+#include "tcg/perf.h"
 #include "trace.h"
 
 static NotifierList exit_notifiers =
@@ -832,5 +833,8 @@ void qemu_cleanup(void)
     monitor_cleanup();
     qemu_chr_cleanup();
     user_creatable_cleanup();
+#ifdef CONFIG_TCG
+    perf_exit();
+#endif
     /* TODO: unref root container, check all devices are ok */
 }
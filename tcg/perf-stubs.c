@@ -0,0 +1,32 @@
+/*
+ * Linux perf perf-<pid>.map and jit-<pid>.dump integration,
+ * stubs for hosts without Linux perf.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/error-report.h"
+#include "tcg/perf.h"
+
+void perf_enable_perfmap(void)
+{
+    warn_report("perf map is only supported on Linux hosts");
+}
+
+void perf_enable_jitdump(void)
+{
+    warn_report("jitdump is only supported on Linux hosts");
+}
+
+void perf_report_prologue(const void *start, size_t size)
+{
+}
+
+void perf_report_code(const TranslationBlock *tb, const void *start)
+{
+}
+
+void perf_exit(void)
+{
+}
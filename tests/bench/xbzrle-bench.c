@@ -0,0 +1,89 @@
+/*
+ * XBZRLE encoder speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/units.h"
+#include "../migration/xbzrle.h"
+
+#define XBZRLE_PAGE_SIZE 4096
+
+typedef int (*XbzrleEncodeFunc)(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                                uint8_t *dst, int dlen);
+
+typedef struct XbzrleBenchOpts {
+    const char *name;
+    XbzrleEncodeFunc encode;
+    /* one changed byte every @stride bytes */
+    int stride;
+} XbzrleBenchOpts;
+
+static void test_encode_speed(const void *opaque)
+{
+    const XbzrleBenchOpts *opts = opaque;
+    uint8_t *old_buf = g_malloc(XBZRLE_PAGE_SIZE);
+    uint8_t *new_buf = g_malloc(XBZRLE_PAGE_SIZE);
+    uint8_t *dst = g_malloc(XBZRLE_PAGE_SIZE);
+    const size_t total = 2 * GiB;
+    size_t remain;
+    int i;
+
+    for (i = 0; i < XBZRLE_PAGE_SIZE; i++) {
+        old_buf[i] = g_test_rand_int();
+    }
+    memcpy(new_buf, old_buf, XBZRLE_PAGE_SIZE);
+    for (i = 0; i < XBZRLE_PAGE_SIZE; i += opts->stride) {
+        new_buf[i] ^= 0x55;
+    }
+
+    g_test_timer_start();
+    for (remain = total; remain; remain -= XBZRLE_PAGE_SIZE) {
+        opts->encode(old_buf, new_buf, XBZRLE_PAGE_SIZE, dst,
+                     XBZRLE_PAGE_SIZE);
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("xbzrle(%s): stride %d bytes %.2f MB/sec",
+                   opts->name, opts->stride,
+                   total / MiB / g_test_timer_last());
+
+    g_free(old_buf);
+    g_free(new_buf);
+    g_free(dst);
+}
+
+static const int strides[] = { XBZRLE_PAGE_SIZE, 512, 64, 16 };
+
+static void add_encoder(const char *name, XbzrleEncodeFunc encode)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(strides); i++) {
+        XbzrleBenchOpts *opts = g_new(XbzrleBenchOpts, 1);
+        g_autofree char *path = NULL;
+
+        opts->name = name;
+        opts->encode = encode;
+        opts->stride = strides[i];
+        path = g_strdup_printf("/xbzrle/benchmark/encode/%s/stride-%d",
+                               name, strides[i]);
+        g_test_add_data_func_full(path, opts, test_encode_speed, g_free);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    add_encoder("int", xbzrle_encode_buffer);
+#ifdef CONFIG_AVX2_OPT
+    if (__builtin_cpu_supports("avx2")) {
+        add_encoder("avx2", xbzrle_encode_buffer_avx2);
+    }
+#endif
+
+    return g_test_run();
+}
@@ -373,6 +373,41 @@ static void migrate_set_parameter_int(QTestState *who, const char *parameter,
     migrate_check_parameter_int(who, parameter, value);
 }
 
+static bool migrate_get_parameter_bool(QTestState *who,
+                                       const char *parameter)
+{
+    QDict *rsp;
+    bool result;
+
+    rsp = wait_command(who, "{ 'execute': 'query-migrate-parameters' }");
+    result = qdict_get_bool(rsp, parameter);
+    qobject_unref(rsp);
+    return result;
+}
+
+static void migrate_check_parameter_bool(QTestState *who, const char *parameter,
+                                         bool value)
+{
+    bool result;
+
+    result = migrate_get_parameter_bool(who, parameter);
+    g_assert_cmpint(result, ==, value);
+}
+
+static void migrate_set_parameter_bool(QTestState *who, const char *parameter,
+                                       bool value)
+{
+    QDict *rsp;
+
+    rsp = qtest_qmp(who,
+                    "{ 'execute': 'migrate-set-parameters',"
+                    "'arguments': { %s: %i } }",
+                    parameter, value);
+    g_assert(qdict_haskey(rsp, "return"));
+    qobject_unref(rsp);
+    migrate_check_parameter_bool(who, parameter, value);
+}
+
 static char *migrate_get_parameter_str(QTestState *who,
                                        const char *parameter)
 {
@@ -1149,6 +1184,42 @@ static void test_postcopy_preempt(void)
     test_postcopy_common(&args);
 }
 
+static void *
+test_migrate_postcopy_prefetch_start(QTestState *from,
+                                     QTestState *to)
+{
+    /* The test guest walks memory forward, so faults should prefetch */
+    migrate_set_parameter_int(to, "postcopy-prefetch-window", 64);
+
+    return NULL;
+}
+
+static void
+test_migrate_postcopy_prefetch_finish(QTestState *from,
+                                      QTestState *to,
+                                      void *opaque)
+{
+    int64_t requests = read_ram_property_int(from, "postcopy-requests");
+    int64_t bytes = read_ram_property_int(from, "postcopy-requested-bytes");
+
+    /*
+     * Faults only ask for the host page they hit, anything more was
+     * requested by prefetch.
+     */
+    g_assert_cmpint(requests, >, 0);
+    g_assert_cmpint(bytes, >, requests * qemu_real_host_page_size());
+}
+
+static void test_postcopy_prefetch(void)
+{
+    MigrateCommon args = {
+        .start_hook = test_migrate_postcopy_prefetch_start,
+        .finish_hook = test_migrate_postcopy_prefetch_finish,
+    };
+
+    test_postcopy_common(&args);
+}
+
 #ifdef CONFIG_GNUTLS
 static void test_postcopy_tls_psk(void)
 {
@@ -1833,6 +1904,67 @@ static void test_migrate_auto_converge(void)
     test_migrate_end(from, to, true);
 }
 
+static void test_migrate_auto_converge_adaptive(void)
+{
+    g_autofree char *uri = g_strdup_printf("unix:%s/migsocket", tmpfs);
+    MigrateStart args = {};
+    QTestState *from, *to;
+    int64_t percentage;
+
+    /*
+     * The guest dirties memory much faster than the bandwidth limit
+     * allows to send it, so the adaptive throttle should go straight
+     * past cpu-throttle-initial, which it ignores.
+     */
+    const int64_t init_pct = 5, inc_pct = 10, max_pct = 95;
+
+    if (test_migrate_start(&from, &to, uri, &args)) {
+        return;
+    }
+
+    migrate_set_capability(from, "auto-converge", true);
+    migrate_set_parameter_bool(from, "cpu-throttle-adaptive", true);
+    migrate_set_parameter_int(from, "cpu-throttle-initial", init_pct);
+    migrate_set_parameter_int(from, "cpu-throttle-increment", inc_pct);
+    migrate_set_parameter_int(from, "max-cpu-throttle", max_pct);
+
+    migrate_ensure_non_converge(from);
+
+    /* To check the throttle percentage before it is reset */
+    migrate_set_capability(from, "pause-before-switchover", true);
+
+    /* Wait for the first serial output from the source */
+    wait_for_serial("src_serial");
+
+    migrate_qmp(from, uri, "{}");
+
+    /* Wait for throttling begins */
+    percentage = 0;
+    while (percentage == 0) {
+        percentage = read_migrate_property_int(from, "cpu-throttle-percentage");
+        usleep(100);
+        g_assert_false(got_stop);
+    }
+    /* The first throttle is computed from the dirty rate, not stepped */
+    g_assert_cmpint(percentage, >, init_pct);
+    g_assert_cmpint(percentage, <=, max_pct);
+
+    migrate_ensure_converge(from);
+
+    wait_for_migration_status(from, "pre-switchover", NULL);
+
+    percentage = read_migrate_property_int(from, "cpu-throttle-percentage");
+    g_assert_cmpint(percentage, <=, max_pct);
+    migrate_continue(from, "pre-switchover");
+
+    qtest_qmp_eventwait(to, "RESUME");
+
+    wait_for_serial("dest_serial");
+    wait_for_migration_complete(from);
+
+    test_migrate_end(from, to, true);
+}
+
 static void *
 test_migrate_precopy_tcp_multifd_start_common(QTestState *from,
                                               QTestState *to,
@@ -1864,6 +1996,40 @@ test_migrate_precopy_tcp_multifd_start(QTestState *from,
     return test_migrate_precopy_tcp_multifd_start_common(from, to, "none");
 }
 
+static void *
+test_migrate_precopy_tcp_multifd_zero_pages_start(QTestState *from,
+                                                  QTestState *to)
+{
+    migrate_set_capability(from, "multifd-zero-pages", true);
+    migrate_set_capability(to, "multifd-zero-pages", true);
+
+    return test_migrate_precopy_tcp_multifd_start_common(from, to, "none");
+}
+
+static void
+test_migrate_precopy_tcp_multifd_zero_pages_finish(QTestState *from,
+                                                   QTestState *to,
+                                                   void *opaque)
+{
+    int64_t page_size = read_ram_property_int(from, "page-size");
+    int64_t normal = read_ram_property_int(from, "normal");
+    int64_t duplicate = read_ram_property_int(from, "duplicate");
+    int64_t multifd_bytes = read_ram_property_int(from, "multifd-bytes");
+
+    /* The guest only dirties part of its memory, the rest stays zero */
+    g_assert_cmpint(normal, >, 0);
+    g_assert_cmpint(duplicate, >, 0);
+
+    /*
+     * Zero pages carry no data: the channels sent every normal page plus
+     * the packet headers, which are much smaller than the zero pages.
+     */
+    g_assert_cmpint(multifd_bytes, >=, normal * page_size);
+    g_assert_cmpint(multifd_bytes, <, (normal + duplicate) * page_size);
+    g_assert_cmpint(read_ram_property_int(from, "transferred"), >=,
+                    multifd_bytes);
+}
+
 static void *
 test_migrate_precopy_tcp_multifd_zlib_start(QTestState *from,
                                             QTestState *to)
@@ -1880,6 +2046,15 @@ test_migrate_precopy_tcp_multifd_zstd_start(QTestState *from,
 }
 #endif /* CONFIG_ZSTD */
 
+#ifdef CONFIG_LZ4
+static void *
+test_migrate_precopy_tcp_multifd_lz4_start(QTestState *from,
+                                           QTestState *to)
+{
+    return test_migrate_precopy_tcp_multifd_start_common(from, to, "lz4");
+}
+#endif /* CONFIG_LZ4 */
+
 static void test_multifd_tcp_none(void)
 {
     MigrateCommon args = {
@@ -1889,6 +2064,16 @@ static void test_multifd_tcp_none(void)
     test_precopy_common(&args);
 }
 
+static void test_multifd_tcp_zero_pages(void)
+{
+    MigrateCommon args = {
+        .listen_uri = "defer",
+        .start_hook = test_migrate_precopy_tcp_multifd_zero_pages_start,
+        .finish_hook = test_migrate_precopy_tcp_multifd_zero_pages_finish,
+    };
+    test_precopy_common(&args);
+}
+
 static void test_multifd_tcp_zlib(void)
 {
     MigrateCommon args = {
@@ -1909,6 +2094,17 @@ static void test_multifd_tcp_zstd(void)
 }
 #endif
 
+#ifdef CONFIG_LZ4
+static void test_multifd_tcp_lz4(void)
+{
+    MigrateCommon args = {
+        .listen_uri = "defer",
+        .start_hook = test_migrate_precopy_tcp_multifd_lz4_start,
+    };
+    test_precopy_common(&args);
+}
+#endif
+
 #ifdef CONFIG_GNUTLS
 static void *
 test_migrate_multifd_tcp_tls_psk_start_match(QTestState *from,
@@ -2465,6 +2661,8 @@ int main(int argc, char **argv)
         qtest_add_func("/migration/postcopy/recovery/plain",
                        test_postcopy_recovery);
         qtest_add_func("/migration/postcopy/preempt/plain", test_postcopy_preempt);
+        qtest_add_func("/migration/postcopy/prefetch/plain",
+                       test_postcopy_prefetch);
         qtest_add_func("/migration/postcopy/preempt/recovery/plain",
                        test_postcopy_preempt_recovery);
     }
@@ -2532,16 +2730,24 @@ int main(int argc, char **argv)
                    test_validate_uuid_dst_not_set);
 
     qtest_add_func("/migration/auto_converge", test_migrate_auto_converge);
+    qtest_add_func("/migration/auto_converge/adaptive",
+                   test_migrate_auto_converge_adaptive);
     qtest_add_func("/migration/multifd/tcp/plain/none",
                    test_multifd_tcp_none);
     qtest_add_func("/migration/multifd/tcp/plain/cancel",
                    test_multifd_tcp_cancel);
+    qtest_add_func("/migration/multifd/tcp/plain/zero-pages",
+                   test_multifd_tcp_zero_pages);
     qtest_add_func("/migration/multifd/tcp/plain/zlib",
                    test_multifd_tcp_zlib);
 #ifdef CONFIG_ZSTD
     qtest_add_func("/migration/multifd/tcp/plain/zstd",
                    test_multifd_tcp_zstd);
 #endif
+#ifdef CONFIG_LZ4
+    qtest_add_func("/migration/multifd/tcp/plain/lz4",
+                   test_multifd_tcp_lz4);
+#endif
 #ifdef CONFIG_GNUTLS
     qtest_add_func("/migration/multifd/tcp/tls/psk/match",
                    test_multifd_tcp_tls_psk_match);
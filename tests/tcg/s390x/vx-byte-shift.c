@@ -0,0 +1,146 @@
+/*
+ * vx-byte-shift: byte element shifts by scalar and by vector
+ *
+ * VESL/VESRA/VESRL with a base register and VESLV/VESRAV/VESRLV with
+ * ES8 are translated to the MO_8 gvec shls/sars/shrs and shlv/sarv/shrv
+ * operations, which have no direct x86 host instruction.  Check them
+ * against a scalar reference, including the counts 0, 7 and >= 8 (the
+ * latter are taken modulo the element size).
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include "vx.h"
+
+#define N_COUNTS 8
+
+static inline void vesl(S390Vector *v1, const S390Vector *v3, uint64_t sh)
+{
+    asm volatile("vesl %[v1], %[v3], 0(%[sh]), 0\n"
+                : [v1] "=v" (v1->v)
+                : [v3]  "v" (v3->v)
+                , [sh]  "a" (sh));
+}
+
+static inline void vesra(S390Vector *v1, const S390Vector *v3, uint64_t sh)
+{
+    asm volatile("vesra %[v1], %[v3], 0(%[sh]), 0\n"
+                : [v1] "=v" (v1->v)
+                : [v3]  "v" (v3->v)
+                , [sh]  "a" (sh));
+}
+
+static inline void vesrl(S390Vector *v1, const S390Vector *v3, uint64_t sh)
+{
+    asm volatile("vesrl %[v1], %[v3], 0(%[sh]), 0\n"
+                : [v1] "=v" (v1->v)
+                : [v3]  "v" (v3->v)
+                , [sh]  "a" (sh));
+}
+
+static inline void veslv(S390Vector *v1, const S390Vector *v2,
+                         const S390Vector *v3)
+{
+    asm volatile("veslv %[v1], %[v2], %[v3], 0\n"
+                : [v1] "=v" (v1->v)
+                : [v2]  "v" (v2->v)
+                , [v3]  "v" (v3->v));
+}
+
+static inline void vesrav(S390Vector *v1, const S390Vector *v2,
+                         const S390Vector *v3)
+{
+    asm volatile("vesrav %[v1], %[v2], %[v3], 0\n"
+                : [v1] "=v" (v1->v)
+                : [v2]  "v" (v2->v)
+                , [v3]  "v" (v3->v));
+}
+
+static inline void vesrlv(S390Vector *v1, const S390Vector *v2,
+                         const S390Vector *v3)
+{
+    asm volatile("vesrlv %[v1], %[v2], %[v3], 0\n"
+                : [v1] "=v" (v1->v)
+                : [v2]  "v" (v2->v)
+                , [v3]  "v" (v3->v));
+}
+
+enum { SHL, SAR, SHR };
+
+static const char *const op_names[] = { "shl", "sar", "shr" };
+
+static uint8_t ref_shift(int op, uint8_t x, unsigned sh)
+{
+    sh &= 7;
+    switch (op) {
+    case SHL:
+        return x << sh;
+    case SAR:
+        return (int8_t)x >> sh;
+    default:
+        return x >> sh;
+    }
+}
+
+static int check(const char *insn, int op, const S390Vector *in,
+                 const S390Vector *sh, const S390Vector *out)
+{
+    int err = 0;
+
+    for (int i = 0; i < 16; i++) {
+        uint8_t exp = ref_shift(op, in->b[i], sh->b[i]);
+
+        if (out->b[i] != exp) {
+            printf("%s (%s) byte %d: 0x%02x by %u = 0x%02x, expected 0x%02x\n",
+                   insn, op_names[op], i, in->b[i], sh->b[i], out->b[i], exp);
+            err = 1;
+        }
+    }
+    return err;
+}
+
+int main(int argc, char *argv[])
+{
+    static const unsigned counts[N_COUNTS] = { 0, 1, 7, 8, 9, 15, 16, 255 };
+    const S390Vector vs = { .b = { 0x00, 0x01, 0x7f, 0x80, 0x81, 0xfe, 0xff,
+                                   0x55, 0xaa, 0x0f, 0xf0, 0x3c, 0xc3, 0x12,
+                                   0xed, 0x40 } };
+    S390Vector vd, vsh;
+    int err = 0;
+
+    /* By scalar: the same count in every element.  */
+    for (int i = 0; i < N_COUNTS; i++) {
+        for (int j = 0; j < 16; j++) {
+            vsh.b[j] = counts[i];
+        }
+
+        vesl(&vd, &vs, counts[i]);
+        err |= check("vesl", SHL, &vs, &vsh, &vd);
+
+        vesra(&vd, &vs, counts[i]);
+        err |= check("vesra", SAR, &vs, &vsh, &vd);
+
+        vesrl(&vd, &vs, counts[i]);
+        err |= check("vesrl", SHR, &vs, &vsh, &vd);
+    }
+
+    /*
+     * By vector: rotate the counts through the elements so that each
+     * count meets each input byte, in both even and odd positions.
+     */
+    for (int i = 0; i < N_COUNTS; i++) {
+        for (int j = 0; j < 16; j++) {
+            vsh.b[j] = counts[(i + j) % N_COUNTS];
+        }
+
+        veslv(&vd, &vs, &vsh);
+        err |= check("veslv", SHL, &vs, &vsh, &vd);
+
+        vesrav(&vd, &vs, &vsh);
+        err |= check("vesrav", SAR, &vs, &vsh, &vd);
+
+        vesrlv(&vd, &vs, &vsh);
+        err |= check("vesrlv", SHR, &vs, &vsh, &vd);
+    }
+
+    return err;
+}
@@ -0,0 +1,91 @@
+/*
+ * Test (and time) self-modifying code the way a guest JIT produces it:
+ * new code is emitted next to code that has already been executed, and
+ * previously executed code is occasionally patched in place.
+ *
+ * This runs in system mode so that every store goes through the softmmu
+ * notdirty path and the per-page code bitmap, as all the stores below
+ * hit a page that holds a live TB.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <minilib.h>
+
+#define CODE_SIZE   4096
+#define STUB_SIZE   8
+#define N_STUBS     (CODE_SIZE / STUB_SIZE)
+#define ITERATIONS  20000
+
+typedef int (*stub_fn)(void);
+
+__attribute__((aligned(CODE_SIZE)))
+static uint8_t code[CODE_SIZE];
+
+/* mov $val, %eax; ret */
+static void emit_stub(uint8_t *p, uint32_t val)
+{
+    p[0] = 0xb8;
+    p[1] = val;
+    p[2] = val >> 8;
+    p[3] = val >> 16;
+    p[4] = val >> 24;
+    p[5] = 0xc3;
+}
+
+static uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+int main(void)
+{
+    uint64_t start, elapsed;
+    int i, got;
+
+    for (i = 0; i < CODE_SIZE; i++) {
+        code[i] = 0xcc;
+    }
+
+    /* Keep stub 0 alive and executed so that the page always holds a TB. */
+    emit_stub(code, 0);
+    got = ((stub_fn)code)();
+    if (got != 0) {
+        ml_printf("FAIL: initial stub returned %d\n", got);
+        return 1;
+    }
+
+    start = rdtsc();
+    for (i = 0; i < ITERATIONS; i++) {
+        int slot = 1 + i % (N_STUBS - 1);
+        uint8_t *p = code + slot * STUB_SIZE;
+
+        /* Emit new code next to live code, as a JIT would. */
+        emit_stub(p, i);
+        got = ((stub_fn)p)();
+        if (got != i) {
+            ml_printf("FAIL: emitted stub %d returned %d\n", i, got);
+            return 1;
+        }
+
+        /* Every so often, patch the live stub in place. */
+        if ((i & 63) == 0) {
+            emit_stub(code, i);
+            got = ((stub_fn)code)();
+            if (got != i) {
+                ml_printf("FAIL: patched stub %d returned %d\n", i, got);
+                return 1;
+            }
+        }
+    }
+    elapsed = rdtsc() - start;
+
+    ml_printf("%d code writes in %ld cycles (%ld per write)\n",
+              i, elapsed, elapsed / i);
+    ml_printf("PASS\n");
+    return 0;
+}
@@ -173,6 +173,62 @@ static void test_encode_decode(void)
     }
 }
 
+#ifdef CONFIG_AVX2_OPT
+static void encode_compare_avx2(void)
+{
+    uint8_t *buffer = g_malloc(XBZRLE_PAGE_SIZE);
+    uint8_t *test = g_malloc(XBZRLE_PAGE_SIZE);
+    uint8_t *compressed = g_malloc(XBZRLE_PAGE_SIZE);
+    uint8_t *compressed_avx2 = g_malloc(XBZRLE_PAGE_SIZE);
+    int changes = g_test_rand_int_range(0, 512);
+    int dlen = g_test_rand_int_range(1, XBZRLE_PAGE_SIZE + 1);
+    int i, rc, rc_avx2;
+
+    for (i = 0; i < XBZRLE_PAGE_SIZE; i++) {
+        buffer[i] = g_test_rand_int();
+    }
+    memcpy(test, buffer, XBZRLE_PAGE_SIZE);
+
+    for (i = 0; i < changes; i++) {
+        int start = g_test_rand_int_range(0, XBZRLE_PAGE_SIZE);
+        int len = g_test_rand_int_range(1, 65);
+        int j;
+
+        for (j = start; j < start + len && j < XBZRLE_PAGE_SIZE; j++) {
+            test[j] ^= g_test_rand_int_range(1, 256);
+        }
+    }
+
+    rc = xbzrle_encode_buffer(buffer, test, XBZRLE_PAGE_SIZE, compressed,
+                              dlen);
+    rc_avx2 = xbzrle_encode_buffer_avx2(buffer, test, XBZRLE_PAGE_SIZE,
+                                        compressed_avx2, dlen);
+    g_assert_cmpint(rc, ==, rc_avx2);
+    if (rc > 0) {
+        g_assert(memcmp(compressed, compressed_avx2, rc) == 0);
+    }
+
+    g_free(buffer);
+    g_free(test);
+    g_free(compressed);
+    g_free(compressed_avx2);
+}
+
+static void test_encode_compare_avx2(void)
+{
+    int i;
+
+    if (!__builtin_cpu_supports("avx2")) {
+        g_test_skip("AVX2 not supported by the host");
+        return;
+    }
+
+    for (i = 0; i < 10000; i++) {
+        encode_compare_avx2();
+    }
+}
+#endif
+
 int main(int argc, char **argv)
 {
     g_test_init(&argc, &argv, NULL);
@@ -185,6 +241,9 @@ int main(int argc, char **argv)
     g_test_add_func("/xbzrle/encode_decode_overflow",
                     test_encode_decode_overflow);
     g_test_add_func("/xbzrle/encode_decode", test_encode_decode);
+#ifdef CONFIG_AVX2_OPT
+    g_test_add_func("/xbzrle/encode_compare_avx2", test_encode_compare_avx2);
+#endif
 
     return g_test_run();
 }